@@ -29,6 +29,13 @@ struct CMempoolAddressDelta
         prevhash.SetNull();
         prevout = 0;
     }
+
+    CMempoolAddressDelta() {
+        time = 0;
+        amount = 0;
+        prevhash.SetNull();
+        prevout = 0;
+    }
 };
 
 struct CMempoolAddressDeltaKey
@@ -54,6 +61,14 @@ struct CMempoolAddressDeltaKey
         index = 0;
         spending = 0;
     }
+
+    CMempoolAddressDeltaKey() {
+        type = 0;
+        addressBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+        spending = 0;
+    }
 };
 
 struct CMempoolAddressDeltaKeyCompare
@@ -79,4 +94,19 @@ struct CMempoolAddressDeltaKeyCompare
     }
 };
 
+/**
+ * Salted hasher for the mempool address index, so that transactions paying
+ * to crafted addresses can't all land in one bucket.
+ */
+class CMempoolAddressHasher
+{
+private:
+    uint64_t k0, k1;
+
+public:
+    CMempoolAddressHasher();
+
+    size_t operator()(const std::pair<uint160, int>& address) const;
+};
+
 #endif // BITCOIN_ADDRESSINDEX_H
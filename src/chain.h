@@ -212,6 +212,8 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
+        if (phashBlock)
+            block.SetCachedHash(*phashBlock);
         return block;
     }
 
@@ -0,0 +1,146 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// ECHO-512 using the AES-NI instructions. Produces the same output as
+// sph_echo512 (crypto/echo.c): each sph AES_ROUND_LE on a little-endian
+// 128-bit word is exactly one AESENC.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include <wmmintrin.h>
+
+namespace echo_aesni
+{
+namespace
+{
+/** 128-bit block counter, as the four little-endian words K0..K3 used by sph. */
+struct Counter
+{
+    uint32_t k[4];
+
+    void Add(uint32_t n)
+    {
+        k[0] += n;
+        if (k[0] < n && ++k[1] == 0 && ++k[2] == 0) ++k[3];
+    }
+};
+
+__attribute__((target("aes,sse2"))) inline __m128i Mul2(__m128i x)
+{
+    // GF(2^8) multiplication by x on every byte.
+    const __m128i poly = _mm_set1_epi8(0x1b);
+    __m128i carry = _mm_cmplt_epi8(x, _mm_setzero_si128());
+    return _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(carry, poly));
+}
+
+__attribute__((target("aes,sse2"))) inline void MixColumn(__m128i* W, int ia, int ib, int ic, int id)
+{
+    __m128i a = W[ia], b = W[ib], c = W[ic], d = W[id];
+    __m128i ab = _mm_xor_si128(a, b);
+    __m128i bc = _mm_xor_si128(b, c);
+    __m128i cd = _mm_xor_si128(c, d);
+    __m128i abx = Mul2(ab);
+    __m128i bcx = Mul2(bc);
+    __m128i cdx = Mul2(cd);
+    W[ia] = _mm_xor_si128(abx, _mm_xor_si128(bc, d));
+    W[ib] = _mm_xor_si128(bcx, _mm_xor_si128(a, cd));
+    W[ic] = _mm_xor_si128(cdx, _mm_xor_si128(ab, d));
+    W[id] = _mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(_mm_xor_si128(cdx, ab), c));
+}
+
+/** One ECHO-512 compression of a 128-byte block with the given counter. */
+__attribute__((target("aes,sse2"))) void Compress(__m128i V[8], const unsigned char* block, Counter counter)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i W[16];
+    __m128i M[8];
+    for (int i = 0; i < 8; i++) {
+        M[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        W[i] = V[i];
+        W[i + 8] = M[i];
+    }
+
+    for (int r = 0; r < 10; r++) {
+        // BIG.SubWords: two AES rounds per word, the first keyed by the counter.
+        for (int n = 0; n < 16; n++) {
+            __m128i k = _mm_set_epi32(counter.k[3], counter.k[2], counter.k[1], counter.k[0]);
+            W[n] = _mm_aesenc_si128(_mm_aesenc_si128(W[n], k), zero);
+            counter.Add(1);
+        }
+
+        // BIG.ShiftRows
+        __m128i t = W[1];
+        W[1] = W[5]; W[5] = W[9]; W[9] = W[13]; W[13] = t;
+        t = W[2]; W[2] = W[10]; W[10] = t;
+        t = W[6]; W[6] = W[14]; W[14] = t;
+        t = W[15];
+        W[15] = W[11]; W[11] = W[7]; W[7] = W[3]; W[3] = t;
+
+        // BIG.MixColumns
+        MixColumn(W, 0, 1, 2, 3);
+        MixColumn(W, 4, 5, 6, 7);
+        MixColumn(W, 8, 9, 10, 11);
+        MixColumn(W, 12, 13, 14, 15);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        V[i] = _mm_xor_si128(V[i], _mm_xor_si128(M[i], _mm_xor_si128(W[i], W[i + 8])));
+    }
+}
+} // namespace
+
+__attribute__((target("aes,sse2"))) void Hash512(const unsigned char* data, size_t len, unsigned char* out)
+{
+    static const size_t BLOCK_SIZE = 128;
+    __m128i V[8];
+    for (int i = 0; i < 8; i++) {
+        V[i] = _mm_set_epi32(0, 0, 0, 512);
+    }
+
+    Counter counter = {{0, 0, 0, 0}};
+    while (len >= BLOCK_SIZE) {
+        counter.Add(BLOCK_SIZE * 8);
+        Compress(V, data, counter);
+        data += BLOCK_SIZE;
+        len -= BLOCK_SIZE;
+    }
+
+    // Padding: 0x80, zeros, the 16-bit output size and the 128-bit message
+    // bit counter. A final block without message bits uses a zero counter.
+    unsigned char buf[BLOCK_SIZE];
+    memcpy(buf, data, len);
+    buf[len] = 0x80;
+    memset(buf + len + 1, 0, BLOCK_SIZE - len - 1);
+    counter.Add(len * 8);
+    Counter total = counter;
+    if (len == 0) {
+        counter = Counter{{0, 0, 0, 0}};
+    }
+    if (len + 1 > BLOCK_SIZE - 18) {
+        Compress(V, buf, counter);
+        counter = Counter{{0, 0, 0, 0}};
+        memset(buf, 0, BLOCK_SIZE);
+    }
+    buf[BLOCK_SIZE - 18] = 512 & 0xff;
+    buf[BLOCK_SIZE - 17] = 512 >> 8;
+    for (int i = 0; i < 4; i++) {
+        uint32_t w = total.k[i];
+        buf[BLOCK_SIZE - 16 + 4 * i] = w;
+        buf[BLOCK_SIZE - 15 + 4 * i] = w >> 8;
+        buf[BLOCK_SIZE - 14 + 4 * i] = w >> 16;
+        buf[BLOCK_SIZE - 13 + 4 * i] = w >> 24;
+    }
+    Compress(V, buf, counter);
+
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i*)(out + 16 * i), V[i]);
+    }
+}
+} // namespace echo_aesni
+
+#endif
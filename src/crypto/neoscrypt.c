@@ -2834,11 +2834,19 @@ static void neoscrypt_xor_4way(void *dstp, const void *srcAp,
 #endif
 
 
-/* 4-way NeoScrypt(128, 2, 1) with Salsa20/20 and ChaCha20/20 */
-void neoscrypt_4way(const uchar *password, uchar *output, uchar *scratchpad) {
+/* The set of four 80 byte passwords at the end of a 4-way scratchpad */
+static uint *neoscrypt_4way_passwords(uchar *scratchpad) {
+    const uint N = 128, r = 2;
+
+    return(&((uint *) &scratchpad[0])[4 * (N + 3) * 32 * r]);
+}
+
+/* 4-way NeoScrypt(128, 2, 1) of the passwords already loaded into
+ * the scratchpad */
+static void neoscrypt_4way_core(uchar *output, uchar *scratchpad) {
     const uint N = 128, r = 2, double_rounds = 10;
     uint *X, *Z, *V, *Y, *P;
-    uint i, j0, j1, j2, j3, k;
+    uint i, j0, j1, j2, j3;
 
     /* 2 * BLOCK_SIZE compacted to 128 below */;
 
@@ -2850,13 +2858,7 @@ void neoscrypt_4way(const uchar *password, uchar *output, uchar *scratchpad) {
     /* Y is a temporary work space */
     Y = &X[4 * (N + 2) * 32 * r];
     /* P is a set of passwords 80 bytes each */
-    P = &X[4 * (N + 3) * 32 * r];
-
-    /* Load the password and increment nonces */
-    for(k = 0; k < 4; k++) {
-        neoscrypt_copy(&P[k * 20], password, 80);
-        P[(k + 1) * 20 - 1] += k;
-    }
+    P = neoscrypt_4way_passwords(scratchpad);
 
     neoscrypt_fastkdf_4way((uchar *) &P[0], (uchar *) &P[0], (uchar *) &Y[0],
       (uchar *) &scratchpad[0], 0);
@@ -2919,6 +2921,31 @@ void neoscrypt_4way(const uchar *password, uchar *output, uchar *scratchpad) {
       (uchar *) &scratchpad[0], 1);
 }
 
+/* 4-way NeoScrypt(128, 2, 1) with Salsa20/20 and ChaCha20/20
+ * of a password and its next three nonces */
+void neoscrypt_4way(const uchar *password, uchar *output, uchar *scratchpad) {
+    uint *P = neoscrypt_4way_passwords(scratchpad);
+    uint k;
+
+    /* Load the password and increment nonces */
+    for(k = 0; k < 4; k++) {
+        neoscrypt_copy(&P[k * 20], password, 80);
+        P[(k + 1) * 20 - 1] += k;
+    }
+
+    neoscrypt_4way_core(output, scratchpad);
+}
+
+/* 4-way NeoScrypt(128, 2, 1) with Salsa20/20 and ChaCha20/20
+ * of four independent passwords stored back to back */
+void neoscrypt_4way_multi(const uchar *passwords, uchar *output, uchar *scratchpad) {
+    uint *P = neoscrypt_4way_passwords(scratchpad);
+
+    neoscrypt_copy(&P[0], passwords, 4 * 80);
+
+    neoscrypt_4way_core(output, scratchpad);
+}
+
 #ifdef SHA256
 /* 4-way Scrypt(1024, 1, 1) with Salsa20/8 */
 void scrypt_4way(const uchar *password, uchar *output, uchar *scratchpad) {
@@ -3253,6 +3280,30 @@ void neoscrypt_fastkdf_4way(const uchar *password, const uchar *salt,
 
 #endif /* (ASM) && (MINER_4WAY) */
 
+/* NeoScrypt(128, 2, 1) of count 80 byte inputs stored back to back;
+ * uses the 4-way SSE2 code for groups of four if available */
+void neoscrypt_batch(const uchar *input, uchar *output, uint count) {
+    uint i = 0;
+
+#if defined(ASM) && defined(MINER_4WAY)
+    /* SSE2 */
+    if((count >= 4) && (cpu_vec_exts() & 0x00000020)) {
+        const size_t align = 0x40;
+        /* Scratchpad size is 4 * ((N + 3) * r * 128 + 80) bytes */
+        uchar *alloc = (uchar *) malloc(4 * ((128 + 3) * 2 * 128 + 80) + align);
+        if(alloc) {
+            uchar *scratchpad = (uchar *) (((size_t)alloc + align - 1) & ~(align - 1));
+            for(; i + 4 <= count; i += 4)
+              neoscrypt_4way_multi(&input[i * 80], &output[i * 32], scratchpad);
+            free(alloc);
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+      neoscrypt(&input[i * 80], &output[i * 32], 0);
+}
+
 #ifndef ASM
 uint cpu_vec_exts() {
 
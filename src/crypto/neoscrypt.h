@@ -22,6 +22,9 @@ void scrypt_4way(const unsigned char *password, unsigned char *output,
   unsigned char *scratchpad);
 #endif
 
+void neoscrypt_4way_multi(const unsigned char *passwords,
+  unsigned char *output, unsigned char *scratchpad);
+
 void neoscrypt_blake2s_4way(const unsigned char *input,
   const unsigned char *key, unsigned char *output);
 
@@ -30,8 +33,16 @@ void neoscrypt_fastkdf_4way(const unsigned char *password,
   const unsigned int mode);
 #endif
 
+void neoscrypt_batch(const unsigned char *input, unsigned char *output,
+  unsigned int count);
+
 unsigned int cpu_vec_exts(void);
 
+/* The C code under its own name, only built along with the assembly
+ * routines (--enable-neoscrypt-asm) */
+void neoscrypt_ref(const unsigned char *password, unsigned char *output,
+  unsigned int profile);
+
 #if (__cplusplus)
 }
 #else
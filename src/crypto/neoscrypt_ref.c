@@ -0,0 +1,20 @@
+/*
+ * The plain C NeoScrypt as neoscrypt_ref(), built next to the assembly
+ * routines so that they can be checked against each other.
+ */
+
+#undef ASM
+#undef MINER_4WAY
+
+#define neoscrypt neoscrypt_ref
+#define neoscrypt_copy neoscrypt_ref_copy
+#define neoscrypt_erase neoscrypt_ref_erase
+#define neoscrypt_xor neoscrypt_ref_xor
+#define neoscrypt_blake2s neoscrypt_ref_blake2s
+#define neoscrypt_fastkdf neoscrypt_ref_fastkdf
+#define neoscrypt_fastkdf_opt neoscrypt_ref_fastkdf_opt
+#define neoscrypt_pbkdf2_sha256 neoscrypt_ref_pbkdf2_sha256
+#define neoscrypt_batch neoscrypt_ref_batch
+#define cpu_vec_exts neoscrypt_ref_cpu_vec_exts
+
+#include "neoscrypt.c"
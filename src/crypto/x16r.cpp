@@ -0,0 +1,189 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/x16r.h"
+
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_skein.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_cubehash.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_simd.h"
+#include "crypto/sph_echo.h"
+#include "crypto/sph_hamsi.h"
+#include "crypto/sph_fugue.h"
+#include "crypto/sph_shabal.h"
+#include "crypto/sph_whirlpool.h"
+#include "crypto/sph_sha2.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__)
+#include <cpuid.h>
+namespace echo_aesni
+{
+void Hash512(const unsigned char* data, size_t len, unsigned char* out);
+}
+#endif
+
+namespace
+{
+typedef void (*AlgoType)(const unsigned char*, size_t, unsigned char*);
+
+/** Reference implementations on top of the sph code. */
+namespace reference
+{
+/**
+ * Freshly initialized sph contexts. Copying one of these is cheaper than
+ * running the corresponding *_init, several of which expand IVs or clear
+ * large buffers.
+ */
+struct Templates
+{
+    sph_blake512_context blake;
+    sph_bmw512_context bmw;
+    sph_groestl512_context groestl;
+    sph_jh512_context jh;
+    sph_keccak512_context keccak;
+    sph_skein512_context skein;
+    sph_luffa512_context luffa;
+    sph_cubehash512_context cubehash;
+    sph_shavite512_context shavite;
+    sph_simd512_context simd;
+    sph_echo512_context echo;
+    sph_hamsi512_context hamsi;
+    sph_fugue512_context fugue;
+    sph_shabal512_context shabal;
+    sph_whirlpool_context whirlpool;
+    sph_sha512_context sha512;
+
+    Templates()
+    {
+        sph_blake512_init(&blake);
+        sph_bmw512_init(&bmw);
+        sph_groestl512_init(&groestl);
+        sph_jh512_init(&jh);
+        sph_keccak512_init(&keccak);
+        sph_skein512_init(&skein);
+        sph_luffa512_init(&luffa);
+        sph_cubehash512_init(&cubehash);
+        sph_shavite512_init(&shavite);
+        sph_simd512_init(&simd);
+        sph_echo512_init(&echo);
+        sph_hamsi512_init(&hamsi);
+        sph_fugue512_init(&fugue);
+        sph_shabal512_init(&shabal);
+        sph_whirlpool_init(&whirlpool);
+        sph_sha512_init(&sha512);
+    }
+};
+
+const Templates& GetTemplates()
+{
+    // Function-local so that it is ready for hashing done during static
+    // initialization (e.g. the genesis blocks in chainparams).
+    static const Templates templates;
+    return templates;
+}
+
+#define X16R_REFERENCE_ALGO(name, member, prefix)                                \
+    void name(const unsigned char* data, size_t len, unsigned char* out)         \
+    {                                                                            \
+        auto ctx = GetTemplates().member;                                        \
+        prefix(&ctx, data, len);                                                 \
+        prefix##_close(&ctx, out);                                               \
+    }
+
+X16R_REFERENCE_ALGO(Blake, blake, sph_blake512)
+X16R_REFERENCE_ALGO(Bmw, bmw, sph_bmw512)
+X16R_REFERENCE_ALGO(Groestl, groestl, sph_groestl512)
+X16R_REFERENCE_ALGO(Jh, jh, sph_jh512)
+X16R_REFERENCE_ALGO(Keccak, keccak, sph_keccak512)
+X16R_REFERENCE_ALGO(Skein, skein, sph_skein512)
+X16R_REFERENCE_ALGO(Luffa, luffa, sph_luffa512)
+X16R_REFERENCE_ALGO(Cubehash, cubehash, sph_cubehash512)
+X16R_REFERENCE_ALGO(Shavite, shavite, sph_shavite512)
+X16R_REFERENCE_ALGO(Simd, simd, sph_simd512)
+X16R_REFERENCE_ALGO(Echo, echo, sph_echo512)
+X16R_REFERENCE_ALGO(Hamsi, hamsi, sph_hamsi512)
+X16R_REFERENCE_ALGO(Fugue, fugue, sph_fugue512)
+X16R_REFERENCE_ALGO(Shabal, shabal, sph_shabal512)
+X16R_REFERENCE_ALGO(Whirlpool, whirlpool, sph_whirlpool)
+X16R_REFERENCE_ALGO(Sha512, sha512, sph_sha512)
+
+#undef X16R_REFERENCE_ALGO
+
+const AlgoType Algos[X16R_HASH_COUNT] = {
+    Blake, Bmw, Groestl, Jh, Keccak, Skein, Luffa, Cubehash,
+    Shavite, Simd, Echo, Hamsi, Fugue, Shabal, Whirlpool, Sha512
+};
+} // namespace reference
+
+/** Currently selected implementation of each step. */
+AlgoType Algos[X16R_HASH_COUNT] = {
+    reference::Blake, reference::Bmw, reference::Groestl, reference::Jh,
+    reference::Keccak, reference::Skein, reference::Luffa, reference::Cubehash,
+    reference::Shavite, reference::Simd, reference::Echo, reference::Hamsi,
+    reference::Fugue, reference::Shabal, reference::Whirlpool, reference::Sha512
+};
+
+#if defined(__x86_64__) || defined(__amd64__)
+bool HaveAESNI()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return (ecx >> 25) & 1;
+    }
+    return false;
+}
+#endif
+} // namespace
+
+void X16RHashAlgo(int algo, const unsigned char* data, size_t len, unsigned char out[X16R_OUTPUT_SIZE])
+{
+    assert(algo >= 0 && algo < X16R_HASH_COUNT);
+    Algos[algo](data, len, out);
+}
+
+void X16RHashAlgoReference(int algo, const unsigned char* data, size_t len, unsigned char out[X16R_OUTPUT_SIZE])
+{
+    assert(algo >= 0 && algo < X16R_HASH_COUNT);
+    reference::Algos[algo](data, len, out);
+}
+
+void X16RHashBatch(const int order[X16R_HASH_COUNT], const unsigned char* const* data, size_t len, size_t n, unsigned char (*out)[X16R_OUTPUT_SIZE])
+{
+    static const unsigned char blank[1] = {0};
+    unsigned char tmp[X16R_OUTPUT_SIZE];
+
+    for (int i = 0; i < X16R_HASH_COUNT; i++) {
+        assert(order[i] >= 0 && order[i] < X16R_HASH_COUNT);
+        AlgoType algo = Algos[order[i]];
+        for (size_t j = 0; j < n; j++) {
+            if (i == 0) {
+                algo(len ? data[j] : blank, len, out[j]);
+            } else {
+                memcpy(tmp, out[j], sizeof(tmp));
+                algo(tmp, sizeof(tmp), out[j]);
+            }
+        }
+    }
+}
+
+std::string X16RAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(__x86_64__) || defined(__amd64__)
+    if (HaveAESNI()) {
+        Algos[10] = echo_aesni::Hash512;
+        ret = "echo=aesni";
+    }
+#endif
+    return ret;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_X16R_H
+#define BITCOIN_CRYPTO_X16R_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Number of hash functions chained by X16R. */
+static const int X16R_HASH_COUNT = 16;
+/** Output size of every function in the X16R chain. */
+static const size_t X16R_OUTPUT_SIZE = 64;
+
+/** Compute one step of the X16R chain: the 512-bit hash of data using
+ *  algorithm algo (0 = blake ... 15 = sha512, in hashPrevBlock nibble order).
+ *  Uses the fastest implementation selected by X16RAutoDetect().
+ */
+void X16RHashAlgo(int algo, const unsigned char* data, size_t len, unsigned char out[X16R_OUTPUT_SIZE]);
+
+/** Run the chain given by order over n messages of len bytes each.
+ *  Every message goes through step i before any goes through step i+1, so the
+ *  code and tables of each primitive stay hot in cache for the whole batch.
+ *  out[j] receives the final 512-bit state for data[j].
+ */
+void X16RHashBatch(const int order[X16R_HASH_COUNT], const unsigned char* const* data, size_t len, size_t n, unsigned char (*out)[X16R_OUTPUT_SIZE]);
+
+/** Compute a step with the portable sph reference implementation, regardless
+ *  of what X16RAutoDetect() selected.
+ */
+void X16RHashAlgoReference(int algo, const unsigned char* data, size_t len, unsigned char out[X16R_OUTPUT_SIZE]);
+
+/** Select the fastest implementations supported by this CPU. Not thread-safe;
+ *  call once at startup. Returns a description of the selection.
+ */
+std::string X16RAutoDetect();
+
+#endif // BITCOIN_CRYPTO_X16R_H
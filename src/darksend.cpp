@@ -9,6 +9,7 @@
 #include "governance.h"
 #include "init.h"
 #include "instantx.h"
+#include "messagesigcache.h"
 #include "safenode-payments.h"
 #include "safenode-sync.h"
 #include "safenodeman.h"
@@ -2300,19 +2301,29 @@ bool CDarkSendSigner::VerifyMessage(CPubKey pubkey, const std::vector<unsigned c
     ss << strMessageMagic;
     ss << strMessage;
 
+    uint256 hash = ss.GetHash();
+    CKeyID keyID = pubkey.GetID();
+
+    // same message relayed by several peers or reprocessed later
+    if(IsMessageSignatureCached(hash, vchSig, keyID)) {
+        return true;
+    }
+
     CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(ss.GetHash(), vchSig)) {
+    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
 
-    if(pubkeyFromSig.GetID() != pubkey.GetID()) {
+    if(pubkeyFromSig.GetID() != keyID) {
         strErrorRet = strprintf("Keys don't match: pubkey=%s, pubkeyFromSig=%s, strMessage=%s, vchSig=%s",
-                    pubkey.GetID().ToString(), pubkeyFromSig.GetID().ToString(), strMessage,
+                    keyID.ToString(), pubkeyFromSig.GetID().ToString(), strMessage,
                     EncodeBase64(&vchSig[0], vchSig.size()));
         return false;
     }
 
+    AddMessageSignatureToCache(hash, vchSig, keyID);
+
     return true;
 }
 
@@ -33,6 +33,9 @@ private:
         IncorrectFormat
     };
 
+    // magic messages are short, anything longer is not one of our files
+    static const unsigned int MAX_MAGIC_MESSAGE_SIZE = 256;
+
     boost::filesystem::path pathDB;
     std::string strFilename;
     std::string strMagicMessage;
@@ -43,36 +46,63 @@ private:
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
-
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        // open temp output file, and associate with CAutoFile
+        boost::filesystem::path pathTmp = GetDataDir() / (strFilename + ".new");
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
+        // serialize straight to the file, checksum data up to that point, then append checksum
         try {
-            fileout << ssObj;
+            CHashingWriter<CAutoFile> hashwriter(&fileout);
+            hashwriter << strMagicMessage; // specific magic message for this type of object
+            hashwriter << FLATDATA(Params().MessageStart()); // network specific magic number
+            hashwriter << objToSave;
+            fileout << hashwriter.GetHash();
         }
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        // replace the existing file only once the new one is complete on disk
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed", __func__);
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    /**
+     * Hash the data and compare it with the checksum at the end of the file, i.e. check that
+     * the hash of everything but the last 32 bytes is those 32 bytes. The file is streamed
+     * through the hasher instead of being buffered, nDataSizeRet is set to the size of the data.
+     */
+    bool VerifyChecksum(CAutoFile& filein, uint64_t& nDataSizeRet)
+    {
+        try {
+            uint64_t nFileSize = boost::filesystem::file_size(pathDB);
+            if (nFileSize < sizeof(uint256))
+                return false;
+            nDataSizeRet = nFileSize - sizeof(uint256);
+
+            CHashVerifier<CAutoFile> verifier(&filein);
+            verifier.ignore(nDataSizeRet);
+
+            uint256 hashIn;
+            filein >> hashIn;
+            return hashIn == verifier.GetHash();
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    ReadResult Read(T& objToLoad)
     {
         //LOCK(objToLoad.cs);
 
@@ -86,43 +116,25 @@ private:
             return FileError;
         }
 
-        // use file size to size memory buffer
-        int fileSize = boost::filesystem::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0)
-            dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
-
-        // read data and checksum from file
-        try {
-            filein.read((char *)&vchData[0], dataSize);
-            filein >> hashIn;
-        }
-        catch (std::exception &e) {
-            error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            return HashReadError;
-        }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-        // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-        if (hashIn != hashTmp)
+        // verify stored checksum matches input data before parsing any of it,
+        // then deserialize straight from the file in a second pass
+        uint64_t nDataSize = 0;
+        if (!VerifyChecksum(filein, nDataSize))
         {
             error("%s: Checksum mismatch, data corrupted", __func__);
             return IncorrectHash;
         }
-
+        if (fseek(filein.Get(), 0, SEEK_SET))
+        {
+            error("%s: Failed to rewind file %s", __func__, pathDB.string());
+            return FileError;
+        }
 
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            filein >> LIMITED_STRING(strMagicMessageTmp, MAX_MAGIC_MESSAGE_SIZE);
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
@@ -133,7 +145,7 @@ private:
 
 
             // de-serialize file header (network specific magic number) and ..
-            ssObj >> FLATDATA(pchMsgTmp);
+            filein >> FLATDATA(pchMsgTmp);
 
             // ... verify the network matches ours
             if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
@@ -143,7 +155,7 @@ private:
             }
 
             // de-serialize data into T object
-            ssObj >> objToLoad;
+            filein >> objToLoad;
         }
         catch (std::exception &e) {
             objToLoad.Clear();
@@ -151,12 +163,53 @@ private:
             return IncorrectFormat;
         }
 
+        // intact data that doesn't end right before the checksum was written in another format
+        long nPos = ftell(filein.Get());
+        if (nPos < 0 || (uint64_t)nPos != nDataSize)
+        {
+            objToLoad.Clear();
+            error("%s: Data has invalid format", __func__);
+            return IncorrectFormat;
+        }
+        filein.fclose();
+
         LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToLoad.ToString());
-        if(!fDryRun) {
-            LogPrintf("%s: Cleaning....\n", __func__);
-            objToLoad.CheckAndRemove();
-            LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    /// Check only the magic message and network magic number at the start of the file
+    ReadResult ReadHeader()
+    {
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            filein >> LIMITED_STRING(strMagicMessageTmp, MAX_MAGIC_MESSAGE_SIZE);
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+
+            filein >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectMagicMessage;
         }
 
         return Ok;
@@ -197,9 +250,11 @@ public:
     {
         int64_t nStart = GetTimeMillis();
 
-        LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        // Only make sure we are not about to overwrite somebody else's file, the data itself
+        // is replaced anyway and was verified when loaded. Parsing it all again here used to
+        // double the memory used and the time spent by every dump.
+        LogPrintf("Verifying %s header...\n", strFilename);
+        ReadResult readResult = ReadHeader();
 
         // there was an error and it was not an error on file opening => do not proceed
         if (readResult == FileError)
@@ -207,13 +262,8 @@ public:
         else if (readResult != Ok)
         {
             LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
-                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
-            else
-            {
-                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
-                return false;
-            }
+            LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+            return false;
         }
 
         LogPrintf("Writting info to %s...\n", strFilename);
@@ -35,6 +35,7 @@ CGovernanceObject::CGovernanceObject()
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  tallyCurrentMNVotes(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -63,6 +64,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  tallyCurrentMNVotes(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -91,6 +93,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   fExpired(other.fExpired),
   fUnparsable(other.fUnparsable),
   mapCurrentMNVotes(other.mapCurrentMNVotes),
+  tallyCurrentMNVotes(other.tallyCurrentMNVotes),
   mapOrphanVotes(other.mapOrphanVotes),
   fileVotes(other.fileVotes)
 {}
@@ -188,7 +191,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR);
         return false;
     }
+    tallyCurrentMNVotes.Add(eSignal, voteInstance.eOutcome, -1);
     voteInstance = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    tallyCurrentMNVotes.Add(eSignal, voteInstance.eOutcome, 1);
     if(!fileVotes.HasVote(vote.GetHash())) {
         fileVotes.AddVote(vote);
     }
@@ -209,6 +214,15 @@ void CGovernanceObject::RebuildVoteMap()
         }
     }
     mapCurrentMNVotes = mapMNVotesNew;
+    RebuildVoteTally();
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    tallyCurrentMNVotes.Clear();
+    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
+        tallyCurrentMNVotes.Add(it->second, 1);
+    }
 }
 
 void CGovernanceObject::ClearSafenodeVotes()
@@ -228,6 +242,7 @@ void CGovernanceObject::ClearSafenodeVotes()
         }
 
         if(fRemove) {
+            tallyCurrentMNVotes.Add(it->second, -1);
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -236,6 +251,13 @@ void CGovernanceObject::ClearSafenodeVotes()
     }
 }
 
+void CGovernanceObject::ClearVotes()
+{
+    mapCurrentMNVotes.clear();
+    tallyCurrentMNVotes.Clear();
+    fDirtyCache = true;
+}
+
 std::string CGovernanceObject::GetSignatureMessage() const
 {
     LOCK(cs);
@@ -605,19 +627,7 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError)
 
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
-    int nCount = 0;
-    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
-        const vote_rec_t& recVote = it->second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 == recVote.mapInstances.end()) {
-            continue;
-        }
-        const vote_instance_t& voteInstance = it2->second;
-        if(voteInstance.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
-    }
-    return nCount;
+    return tallyCurrentMNVotes.Get(eVoteSignalIn, eVoteOutcomeIn);
 }
 
 /**
@@ -26,9 +26,14 @@ class CGovernanceVote;
 static const int MAX_GOVERNANCE_OBJECT_DATA_SIZE = 16 * 1024;
 static const int MIN_GOVERNANCE_PEER_PROTO_VERSION = 70206;
 static const int GOVERNANCE_FILTER_PROTO_VERSION = 70206;
+static const int GOVERNANCE_DIGEST_PROTO_VERSION = 70207;
 
 static const double GOVERNANCE_FILTER_FP_RATE = 0.001;
 
+// Vote set digests are split into buckets of about this many votes each
+static const int GOVERNANCE_DIGEST_VOTES_PER_BUCKET = 8;
+static const int MAX_GOVERNANCE_DIGEST_BUCKETS = 4096;
+
 static const int GOVERNANCE_OBJECT_UNKNOWN = 0;
 static const int GOVERNANCE_OBJECT_PROPOSAL = 1;
 static const int GOVERNANCE_OBJECT_TRIGGER = 2;
@@ -103,6 +108,45 @@ struct vote_rec_t {
      }
 };
 
+/**
+ * Number of safenodes currently voting each outcome of each supported signal,
+ * kept in step with the vote records so vote counts don't require a scan
+ */
+struct vote_tally_t {
+    int nCounts[MAX_SUPPORTED_VOTE_SIGNAL + 1][VOTE_OUTCOME_ABSTAIN + 1];
+
+    vote_tally_t()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(nCounts, 0, sizeof(nCounts));
+    }
+
+    void Add(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+    {
+        if(nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return;
+        if(eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return;
+        nCounts[nSignal][eOutcome] += nDelta;
+    }
+
+    void Add(const vote_rec_t& recVote, int nDelta)
+    {
+        for(vote_instance_m_cit it = recVote.mapInstances.begin(); it != recVote.mapInstances.end(); ++it) {
+            Add(it->first, it->second.eOutcome, nDelta);
+        }
+    }
+
+    int Get(vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome) const
+    {
+        if(eSignal <= VOTE_SIGNAL_NONE || eSignal > MAX_SUPPORTED_VOTE_SIGNAL) return 0;
+        if(eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return 0;
+        return nCounts[eSignal][eOutcome];
+    }
+};
+
 /**
 * Governance Object
 *
@@ -183,6 +227,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Vote counts of mapCurrentMNVotes, must be updated along with it
+    vote_tally_t tallyCurrentMNVotes;
+
     /// Limited map of votes orphaned by MN
     vote_mcache_t mapOrphanVotes;
 
@@ -322,6 +369,9 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if(ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
             READWRITE(fileVotes);
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -338,6 +388,9 @@ public:
 private:
     // FUNCTIONS FOR DEALING WITH DATA STRING
     void LoadData();
+
+    /// Recount tallyCurrentMNVotes from scratch
+    void RebuildVoteTally();
     void GetData(UniValue& objResult);
 
     bool ProcessVote(CNode* pfrom,
@@ -349,6 +402,9 @@ private:
     /// Called when MN's which have voted on this object have been removed
     void ClearSafenodeVotes();
 
+    /// Called when the vote database was wiped, the votes are synced again
+    void ClearVotes();
+
     void CheckOrphanVotes();
 
 };
@@ -4,15 +4,136 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "governance-votedb.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+static const char DB_VOTE = 'v';
+static const char DB_OBJECT_VOTE = 'o';
+static const char DB_CLEAN = 'C';
+
+CGovernanceVoteDB* pgovernancevotedb = NULL;
+
+CGovernanceVoteDB::CGovernanceVoteDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "governance" / "votes", nCacheSize, fMemory, fWipe) {
+}
+
+bool CGovernanceVoteDB::WriteVote(const CGovernanceVote& vote) {
+    uint256 nHash = vote.GetHash();
+    CDBBatch batch(&GetObfuscateKey());
+    batch.Write(std::make_pair(DB_VOTE, nHash), vote);
+    batch.Write(std::make_pair(DB_OBJECT_VOTE, std::make_pair(vote.GetParentHash(), vote_key_t(vote.GetVinSafenode().prevout, nHash))), '1');
+    return WriteBatch(batch);
+}
+
+bool CGovernanceVoteDB::ReadVote(const uint256& nHash, CGovernanceVote& vote) {
+    return Read(std::make_pair(DB_VOTE, nHash), vote);
+}
+
+bool CGovernanceVoteDB::HaveVote(const uint256& nHash) {
+    return Exists(std::make_pair(DB_VOTE, nHash));
+}
+
+bool CGovernanceVoteDB::EraseVotes(const uint256& nParentHash, const std::vector<vote_key_t>& vecKeys) {
+    CDBBatch batch(&GetObfuscateKey());
+    for (std::vector<vote_key_t>::const_iterator it = vecKeys.begin(); it != vecKeys.end(); ++it) {
+        batch.Erase(std::make_pair(DB_VOTE, it->second));
+        batch.Erase(std::make_pair(DB_OBJECT_VOTE, std::make_pair(nParentHash, *it)));
+    }
+    return WriteBatch(batch);
+}
+
+bool CGovernanceVoteDB::ReadVoteHashes(const uint256& nParentHash, std::vector<uint256>& vecHashesRet) {
+    std::vector<vote_key_t> vecKeys;
+    if (!ReadVoteKeys(nParentHash, vecKeys))
+        return false;
+
+    vecHashesRet.reserve(vecHashesRet.size() + vecKeys.size());
+    for (std::vector<vote_key_t>::const_iterator it = vecKeys.begin(); it != vecKeys.end(); ++it) {
+        vecHashesRet.push_back(it->second);
+    }
+
+    return true;
+}
+
+bool CGovernanceVoteDB::ReadVoteKeys(const uint256& nParentHash, std::vector<vote_key_t>& vecKeysRet) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_OBJECT_VOTE, nParentHash));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, vote_key_t> > key;
+        if (pcursor->GetKey(key) && key.first == DB_OBJECT_VOTE && key.second.first == nParentHash) {
+            vecKeysRet.push_back(key.second.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CGovernanceVoteDB::ReadVoteKeys(const uint256& nParentHash, const COutPoint& outpointSafenode, std::vector<vote_key_t>& vecKeysRet) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_OBJECT_VOTE, std::make_pair(nParentHash, outpointSafenode)));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint256, vote_key_t> > key;
+        if (pcursor->GetKey(key) && key.first == DB_OBJECT_VOTE && key.second.first == nParentHash && key.second.second.first == outpointSafenode) {
+            vecKeysRet.push_back(key.second.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CGovernanceVoteDB::ReadAllVoteKeys(std::vector<std::pair<uint256, vote_key_t> >& vecKeysRet) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(DB_OBJECT_VOTE);
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<uint256, vote_key_t> > key;
+        if (pcursor->GetKey(key) && key.first == DB_OBJECT_VOTE) {
+            vecKeysRet.push_back(key.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CGovernanceVoteDB::WriteClean(bool fClean) {
+    return Write(DB_CLEAN, fClean ? '1' : '0', true);
+}
+
+bool CGovernanceVoteDB::IsClean() {
+    char ch;
+    if (!Read(DB_CLEAN, ch))
+        return false;
+    return ch == '1';
+}
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
-    : nMemoryVotes(0),
+    : nParentHash(),
+      nVoteCount(0),
       listVotes(),
       mapVoteIndex()
 {}
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
-    : nMemoryVotes(other.nMemoryVotes),
+    : nParentHash(other.nParentHash),
+      nVoteCount(other.nVoteCount),
       listVotes(other.listVotes),
       mapVoteIndex()
 {
@@ -21,16 +142,25 @@ CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVote
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
+    nParentHash = vote.GetParentHash();
+    if(pgovernancevotedb && !pgovernancevotedb->WriteVote(vote)) {
+        LogPrintf("CGovernanceObjectVoteFile::AddVote -- failed to write vote %s\n", vote.GetHash().ToString());
+        return;
+    }
     listVotes.push_front(vote);
     mapVoteIndex[vote.GetHash()] = listVotes.begin();
-    ++nMemoryVotes;
+    ++nVoteCount;
+    if(pgovernancevotedb && (int)listVotes.size() > MAX_MEMORY_VOTES) {
+        mapVoteIndex.erase(listVotes.back().GetHash());
+        listVotes.pop_back();
+    }
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
     vote_m_cit it = mapVoteIndex.find(nHash);
     if(it == mapVoteIndex.end()) {
-        return false;
+        return pgovernancevotedb && pgovernancevotedb->HaveVote(nHash);
     }
     return true;
 }
@@ -39,7 +169,7 @@ bool CGovernanceObjectVoteFile::GetVote(const uint256& nHash, CGovernanceVote& v
 {
     vote_m_cit it = mapVoteIndex.find(nHash);
     if(it == mapVoteIndex.end()) {
-        return false;
+        return pgovernancevotedb && pgovernancevotedb->ReadVote(nHash, vote);
     }
     vote = *(it->second);
     return true;
@@ -48,30 +178,89 @@ bool CGovernanceObjectVoteFile::GetVote(const uint256& nHash, CGovernanceVote& v
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    if(!pgovernancevotedb) {
+        for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
+            vecResult.push_back(*it);
+        }
+        return vecResult;
+    }
+    std::vector<uint256> vecHashes = GetVoteHashes();
+    vecResult.reserve(vecHashes.size());
+    for(size_t i = 0; i < vecHashes.size(); ++i) {
+        CGovernanceVote vote;
+        if(GetVote(vecHashes[i], vote)) {
+            vecResult.push_back(vote);
+        }
     }
     return vecResult;
 }
 
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    if(!pgovernancevotedb) {
+        for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
+            vecResult.push_back(it->GetHash());
+        }
+        return vecResult;
+    }
+    pgovernancevotedb->ReadVoteHashes(nParentHash, vecResult);
+    return vecResult;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromSafenode(const CTxIn& vinSafenode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetVinSafenode() == vinSafenode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+    std::vector<CGovernanceVoteDB::vote_key_t> vecKeys;
+    if(pgovernancevotedb) {
+        // only the index entries of this safenode are read, not the votes
+        pgovernancevotedb->ReadVoteKeys(nParentHash, vinSafenode.prevout, vecKeys);
+    }
+    else {
+        for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
+            if(it->GetVinSafenode() == vinSafenode) {
+                vecKeys.push_back(CGovernanceVoteDB::vote_key_t(vinSafenode.prevout, it->GetHash()));
+            }
         }
-        else {
-            ++it;
+    }
+    EraseVotes(vecKeys);
+}
+
+void CGovernanceObjectVoteFile::RemoveAllVotes()
+{
+    std::vector<CGovernanceVoteDB::vote_key_t> vecKeys;
+    if(pgovernancevotedb) {
+        pgovernancevotedb->ReadVoteKeys(nParentHash, vecKeys);
+    }
+    else {
+        for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
+            vecKeys.push_back(CGovernanceVoteDB::vote_key_t(it->GetVinSafenode().prevout, it->GetHash()));
+        }
+    }
+    EraseVotes(vecKeys);
+}
+
+void CGovernanceObjectVoteFile::EraseVotes(const std::vector<CGovernanceVoteDB::vote_key_t>& vecKeys)
+{
+    if(vecKeys.empty()) {
+        return;
+    }
+    if(pgovernancevotedb && !pgovernancevotedb->EraseVotes(nParentHash, vecKeys)) {
+        LogPrintf("CGovernanceObjectVoteFile::EraseVotes -- failed to erase votes of %s\n", nParentHash.ToString());
+    }
+    for(size_t i = 0; i < vecKeys.size(); ++i) {
+        vote_m_it it = mapVoteIndex.find(vecKeys[i].second);
+        if(it != mapVoteIndex.end()) {
+            listVotes.erase(it->second);
+            mapVoteIndex.erase(it);
         }
     }
+    nVoteCount = std::max(0, nVoteCount - (int)vecKeys.size());
 }
 
 CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanceObjectVoteFile& other)
 {
-    nMemoryVotes = other.nMemoryVotes;
+    nParentHash = other.nParentHash;
+    nVoteCount = other.nVoteCount;
     listVotes = other.listVotes;
     RebuildIndex();
     return *this;
@@ -80,14 +269,12 @@ CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanc
 void CGovernanceObjectVoteFile::RebuildIndex()
 {
     mapVoteIndex.clear();
-    nMemoryVotes = 0;
     vote_l_it it = listVotes.begin();
     while(it != listVotes.end()) {
         CGovernanceVote& vote = *it;
         uint256 nHash = vote.GetHash();
         if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
             mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
             ++it;
         }
         else {
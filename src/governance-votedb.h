@@ -7,18 +7,57 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
+#include "dbwrapper.h"
 #include "governance-vote.h"
 #include "serialize.h"
 #include "uint256.h"
 
+//! Cache size of the governance vote database (bytes)
+static const size_t GOVERNANCE_VOTEDB_CACHE = 2 << 20;
+
+/**
+ * Access to the governance vote database (governance/votes/)
+ *
+ * Holds every vote we know of keyed by its hash, plus an index of vote hashes
+ * per parent object and safenode outpoint so the votes of one object, or of one
+ * safenode on it, can be listed without reading the others.
+ */
+class CGovernanceVoteDB : public CDBWrapper
+{
+public:
+    /// Index entry of a vote: the safenode outpoint and the vote hash
+    typedef std::pair<COutPoint, uint256> vote_key_t;
+
+    CGovernanceVoteDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CGovernanceVoteDB(const CGovernanceVoteDB&);
+    void operator=(const CGovernanceVoteDB&);
+public:
+    bool WriteVote(const CGovernanceVote& vote);
+    bool ReadVote(const uint256& nHash, CGovernanceVote& vote);
+    bool HaveVote(const uint256& nHash);
+    bool EraseVotes(const uint256& nParentHash, const std::vector<vote_key_t>& vecKeys);
+    bool ReadVoteHashes(const uint256& nParentHash, std::vector<uint256>& vecHashesRet);
+    bool ReadVoteKeys(const uint256& nParentHash, std::vector<vote_key_t>& vecKeysRet);
+    /// Only the votes of one safenode on the object
+    bool ReadVoteKeys(const uint256& nParentHash, const COutPoint& outpointSafenode, std::vector<vote_key_t>& vecKeysRet);
+    bool ReadAllVoteKeys(std::vector<std::pair<uint256, vote_key_t> >& vecKeysRet);
+    /// Set once governance.dat has been written to match the database, cleared while running
+    bool WriteClean(bool fClean);
+    bool IsClean();
+};
+
+/** Global variable that points to the governance vote database (protected by governance.cs) */
+extern CGovernanceVoteDB* pgovernancevotedb;
+
 /**
  * Represents the collection of votes associated with a given CGovernanceObject
  * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
+ * which older votes are only kept in the vote database and read back on demand.
  *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Without a vote database (e.g. in unit tests) every vote is held in memory.
  */
 class CGovernanceObjectVoteFile
 {
@@ -36,9 +75,11 @@ public: // Types
     typedef vote_m_t::const_iterator vote_m_cit;
 
 private:
-    static const int MAX_MEMORY_VOTES = -1;
+    static const int MAX_MEMORY_VOTES = 100;
 
-    int nMemoryVotes;
+    uint256 nParentHash;
+
+    int nVoteCount;
 
     vote_l_t listVotes;
 
@@ -55,39 +96,60 @@ public:
     void AddVote(const CGovernanceVote& vote);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Return true if the vote with this hash is in the file
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote, reading it from the vote database unless it's cached in memory
      */
     bool GetVote(const uint256& nHash, CGovernanceVote& vote) const;
 
     int GetVoteCount() {
-        return nMemoryVotes;
+        return nVoteCount;
+    }
+
+    /**
+     * Called when the indexes are rebuilt on load, the database is authoritative
+     */
+    void SetVoteCount(int nVoteCountIn) {
+        nVoteCount = nVoteCountIn;
     }
 
+    /**
+     * Load all votes of the object, use GetVoteHashes when the votes themselves aren't needed
+     */
     std::vector<CGovernanceVote> GetVotes() const;
 
+    std::vector<uint256> GetVoteHashes() const;
+
     CGovernanceObjectVoteFile& operator=(const CGovernanceObjectVoteFile& other);
 
     void RemoveVotesFromSafenode(const CTxIn& vinSafenode);
 
+    /**
+     * Erase the stored votes, called when the parent object is deleted
+     */
+    void RemoveAllVotes();
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
+        // votes themselves are in the vote database
+        READWRITE(nParentHash);
+        READWRITE(nVoteCount);
         if(ser_action.ForRead()) {
-            RebuildIndex();
+            listVotes.clear();
+            mapVoteIndex.clear();
         }
     }
 private:
     void RebuildIndex();
 
+    void EraseVotes(const std::vector<CGovernanceVoteDB::vote_key_t>& vecKeys);
+
 };
 
 #endif
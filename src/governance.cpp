@@ -18,7 +18,17 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-11";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-12";
+
+// Two vote sets differ in a bucket only if its digests differ (barring collisions)
+std::vector<uint64_t> GetGovernanceVoteDigests(const std::vector<uint256>& vecHashes, size_t nBuckets)
+{
+    std::vector<uint64_t> vecDigests(nBuckets, 0);
+    for(size_t i = 0; i < vecHashes.size(); ++i) {
+        vecDigests[vecHashes[i].GetCheapHash() % nBuckets] ^= vecHashes[i].GetUint64(1);
+    }
+    return vecDigests;
+}
 
 CGovernanceManager::CGovernanceManager()
     : pCurrentBlockIndex(NULL),
@@ -146,6 +156,27 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
 
     }
 
+    // A PEER SENT THE DIGESTS OF ITS VOTES FOR AN OBJECT, SEND IT WHAT IT'S MISSING
+    else if (strCommand == NetMsgType::MNGOVERNANCEDIGEST)
+    {
+        // Ignore such requests until we are fully synced, same as MNGOVERNANCESYNC
+        if (!safenodeSync.IsSynced()) return;
+
+        uint256 nProp;
+        std::vector<uint64_t> vecDigests;
+
+        vRecv >> nProp >> vecDigests;
+
+        if(vecDigests.size() > (size_t)MAX_GOVERNANCE_DIGEST_BUCKETS) {
+            LogPrint("gobject", "MNGOVERNANCEDIGEST -- too many buckets %d, peer=%d\n", vecDigests.size(), pfrom->id);
+            Misbehaving(pfrom->GetId(), 20);
+            return;
+        }
+
+        SyncVotesByDigest(pfrom, nProp, vecDigests);
+        LogPrint("gobject", "MNGOVERNANCEDIGEST -- syncing governance votes to our peer at %s\n", pfrom->addr.ToString());
+    }
+
     // A NEW GOVERNANCE OBJECT HAS ARRIVED
     else if (strCommand == NetMsgType::MNGOVERNANCEOBJECT)
 
@@ -535,6 +566,7 @@ void CGovernanceManager::UpdateCachesAndClean()
             if(pObj->nObjectType == GOVERNANCE_OBJECT_WATCHDOG) {
                 mapWatchdogObjects.erase(it->first);
             }
+            pObj->GetVoteFile().RemoveAllVotes();
             mapObjects.erase(it++);
         } else {
             ++it;
@@ -816,6 +848,64 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
     LogPrintf("CGovernanceManager::Sync -- sent %d objects and %d votes to peer=%d\n", nObjCount, nVoteCount, pfrom->id);
 }
 
+void CGovernanceManager::SyncVotesByDigest(CNode* pfrom, const uint256& nProp, const std::vector<uint64_t>& vecDigests)
+{
+    // do not provide any data until our node is synced
+    if(fSafeNode && !safenodeSync.IsSynced()) return;
+
+    int nVoteCount = 0;
+    int nBucketCount = 0;
+
+    {
+        LOCK2(cs_main, cs);
+
+        object_m_it it = mapObjects.find(nProp);
+        if(it == mapObjects.end()) {
+            LogPrint("gobject", "CGovernanceManager::SyncVotesByDigest -- no matching object for hash %s, peer=%d\n", nProp.ToString(), pfrom->id);
+            return;
+        }
+        CGovernanceObject& govobj = it->second;
+
+        if(govobj.IsSetCachedDelete() || govobj.IsSetExpired()) {
+            LogPrint("gobject", "CGovernanceManager::SyncVotesByDigest -- not syncing deleted/expired govobj: %s, peer=%d\n",
+                     nProp.ToString(), pfrom->id);
+            return;
+        }
+
+        // an empty vote set is sent as no buckets at all
+        std::vector<uint64_t> vecPeerDigests = vecDigests;
+        if(vecPeerDigests.empty()) {
+            vecPeerDigests.push_back(0);
+        }
+
+        std::vector<uint256> vecHashes = govobj.GetVoteFile().GetVoteHashes();
+        std::vector<uint64_t> vecOurDigests = GetGovernanceVoteDigests(vecHashes, vecPeerDigests.size());
+        for(size_t i = 0; i < vecOurDigests.size(); ++i) {
+            if(vecOurDigests[i] != vecPeerDigests[i]) {
+                ++nBucketCount;
+            }
+        }
+
+        // only votes in buckets that differ are loaded and offered
+        for(size_t i = 0; nBucketCount > 0 && i < vecHashes.size(); ++i) {
+            size_t nBucket = vecHashes[i].GetCheapHash() % vecPeerDigests.size();
+            if(vecOurDigests[nBucket] == vecPeerDigests[nBucket]) {
+                continue;
+            }
+            CGovernanceVote vote;
+            if(!govobj.GetVoteFile().GetVote(vecHashes[i], vote) || !vote.IsValid(true)) {
+                continue;
+            }
+            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecHashes[i]));
+            ++nVoteCount;
+        }
+    }
+
+    pfrom->PushMessage(NetMsgType::SYNCSTATUSCOUNT, SAFENODE_SYNC_GOVOBJ_VOTE, nVoteCount);
+    LogPrint("gobject", "CGovernanceManager::SyncVotesByDigest -- sent %d votes from %d of %d buckets to peer=%d\n",
+             nVoteCount, nBucketCount, std::max<size_t>(vecDigests.size(), 1), pfrom->id);
+}
+
 bool CGovernanceManager::SafenodeRateCheck(const CGovernanceObject& govobj, update_mode_enum_t eUpdateLast)
 {
     bool fRateCheckBypassed = false;
@@ -1053,6 +1143,26 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
         return;
     }
 
+    // Peers that understand vote set digests only send us the votes we lack
+    // instead of testing every one of theirs against a bloom filter
+    if(fUseFilter && pfrom->nVersion >= GOVERNANCE_DIGEST_PROTO_VERSION) {
+        std::vector<uint64_t> vecDigests;
+        {
+            LOCK(cs);
+            CGovernanceObject* pObj = FindGovernanceObject(nHash);
+            if(pObj) {
+                std::vector<uint256> vecHashes = pObj->GetVoteFile().GetVoteHashes();
+                size_t nBuckets = (vecHashes.size() + GOVERNANCE_DIGEST_VOTES_PER_BUCKET - 1) / GOVERNANCE_DIGEST_VOTES_PER_BUCKET;
+                nBuckets = std::min(nBuckets, (size_t)MAX_GOVERNANCE_DIGEST_BUCKETS);
+                if(nBuckets > 0) {
+                    vecDigests = GetGovernanceVoteDigests(vecHashes, nBuckets);
+                }
+            }
+        }
+        pfrom->PushMessage(NetMsgType::MNGOVERNANCEDIGEST, nHash, vecDigests);
+        return;
+    }
+
     CBloomFilter filter;
     filter.clear();
 
@@ -1062,9 +1172,9 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
+            std::vector<uint256> vecHashes = pObj->GetVoteFile().GetVoteHashes();
+            for(size_t i = 0; i < vecHashes.size(); ++i) {
+                filter.insert(vecHashes[i]);
             }
         }
     }
@@ -1209,12 +1319,43 @@ bool CGovernanceManager::AcceptMessage(const uint256& nHash, hash_s_t& setHash)
 void CGovernanceManager::RebuildIndexes()
 {
     mapVoteToObject.Clear();
-    for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
-        CGovernanceObject& govobj = it->second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            mapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+    if(!pgovernancevotedb) {
+        for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+            CGovernanceObject& govobj = it->second;
+            std::vector<uint256> vecHashes = govobj.GetVoteFile().GetVoteHashes();
+            for(size_t i = 0; i < vecHashes.size(); ++i) {
+                mapVoteToObject.Insert(vecHashes[i], &govobj);
+            }
         }
+        return;
+    }
+
+    // One pass over the vote database, only the keys are read. Votes of objects
+    // we no longer have (e.g. the cache was cleared) are erased on the way.
+    std::vector<std::pair<uint256, CGovernanceVoteDB::vote_key_t> > vecKeys;
+    pgovernancevotedb->ReadAllVoteKeys(vecKeys);
+
+    std::map<uint256, int> mapVoteCounts;
+    std::map<uint256, std::vector<CGovernanceVoteDB::vote_key_t> > mapOrphans;
+    for(size_t i = 0; i < vecKeys.size(); ++i) {
+        object_m_it it = mapObjects.find(vecKeys[i].first);
+        if(it == mapObjects.end()) {
+            mapOrphans[vecKeys[i].first].push_back(vecKeys[i].second);
+            continue;
+        }
+        mapVoteToObject.Insert(vecKeys[i].second.second, &it->second);
+        ++mapVoteCounts[it->first];
+    }
+
+    for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+        it->second.GetVoteFile().SetVoteCount(mapVoteCounts[it->first]);
+    }
+
+    for(std::map<uint256, std::vector<CGovernanceVoteDB::vote_key_t> >::iterator it = mapOrphans.begin(); it != mapOrphans.end(); ++it) {
+        pgovernancevotedb->EraseVotes(it->first, it->second);
+    }
+    if(!mapOrphans.empty()) {
+        LogPrintf("CGovernanceManager::RebuildIndexes -- erased votes of %d unknown objects\n", (int)mapOrphans.size());
     }
 }
 
@@ -1267,6 +1408,14 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+void CGovernanceManager::ClearVotes()
+{
+    LOCK(cs);
+    for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+        it->second.ClearVotes();
+    }
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
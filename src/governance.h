@@ -26,6 +26,12 @@ class CGovernanceVote;
 
 extern CGovernanceManager governance;
 
+/**
+ * Split vote hashes into nBuckets buckets and XOR a 64 bit piece of each hash into its bucket's
+ * digest, as sent in MNGOVERNANCEDIGEST
+ */
+std::vector<uint64_t> GetGovernanceVoteDigests(const std::vector<uint256>& vecHashes, size_t nBuckets);
+
 typedef std::pair<CGovernanceObject, int64_t> object_time_pair_t;
 
 static const int RATE_BUFFER_SIZE = 5;
@@ -283,6 +289,11 @@ public:
 
     void Sync(CNode* node, const uint256& nProp, const CBloomFilter& filter);
 
+    /**
+     * Send the peer the votes of an object it is missing, given the digests of its vote set
+     */
+    void SyncVotesByDigest(CNode* pfrom, const uint256& nProp, const std::vector<uint64_t>& vecDigests);
+
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
     void DoMaintenance();
@@ -391,6 +402,9 @@ public:
 
     void InitOnLoad();
 
+    /// Forget the tallies of all objects, for when the vote database had to be wiped
+    void ClearVotes();
+
     int RequestGovernanceObjectVotes(CNode* pnode);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy);
 
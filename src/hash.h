@@ -33,6 +33,7 @@
 extern "C" {
 #include "crypto/sph_sha2.h"
 }
+#include "crypto/x16r.h"
 #include <vector>
 
 typedef uint256 ChainCode;
@@ -304,7 +305,33 @@ public:
     CHashVerifier<Source>& operator>>(T& obj)
     {
         // Unserialize from this stream
-        ::Unserialize(*this, obj);
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/** Writes data to an underlying stream, while hashing the written data. */
+template<typename Target>
+class CHashingWriter : public CHashWriter
+{
+private:
+    Target* target;
+
+public:
+    explicit CHashingWriter(Target* target_) : CHashWriter(target_->GetType(), target_->GetVersion()), target(target_) {}
+
+    CHashingWriter<Target>& write(const char* pch, size_t nSize)
+    {
+        target->write(pch, nSize);
+        CHashWriter::write(pch, nSize);
+        return (*this);
+    }
+
+    template<typename T>
+    CHashingWriter<Target>& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj, nType, nVersion);
         return (*this);
     }
 };
@@ -370,132 +397,57 @@ extern double algoHashTotal[16];
 extern int algoHashHits[16];
 
 
-template<typename T1>
-inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+/**
+ * The X16R chain implied by a hashPrevBlock, resolved once: the algorithm used
+ * by each of the 16 steps. Headers sharing a parent (e.g. all nonces tried by
+ * the miner) can be hashed through a single plan.
+ */
+class CX16RPlan
 {
-//	static std::chrono::duration<double>[16];
-    int hashSelection;
-
-    sph_blake512_context     ctx_blake;      //0
-    sph_bmw512_context       ctx_bmw;        //1
-    sph_groestl512_context   ctx_groestl;    //2
-    sph_jh512_context        ctx_jh;         //3
-    sph_keccak512_context    ctx_keccak;     //4
-    sph_skein512_context     ctx_skein;      //5
-    sph_luffa512_context     ctx_luffa;      //6
-    sph_cubehash512_context  ctx_cubehash;   //7
-    sph_shavite512_context   ctx_shavite;    //8
-    sph_simd512_context      ctx_simd;       //9
-    sph_echo512_context      ctx_echo;       //A
-    sph_hamsi512_context     ctx_hamsi;      //B
-    sph_fugue512_context     ctx_fugue;      //C
-    sph_shabal512_context    ctx_shabal;     //D
-    sph_whirlpool_context    ctx_whirlpool;  //E
-    sph_sha512_context       ctx_sha512;     //F
+private:
+    uint256 hashPrevBlock;
+    int order[X16R_HASH_COUNT];
 
-    static unsigned char pblank[1];
+public:
+    explicit CX16RPlan(const uint256& hashPrevBlockIn) : hashPrevBlock(hashPrevBlockIn)
+    {
+        for (int i = 0; i < X16R_HASH_COUNT; i++)
+            order[i] = GetHashSelection(hashPrevBlock, i);
+    }
 
-    uint512 hash[16];
+    const uint256& GetPrevBlockHash() const { return hashPrevBlock; }
 
-    for (int i=0;i<16;i++) 
+    /** Compute the X16R hash of len bytes at data. */
+    uint256 Hash(const unsigned char* data, size_t len) const
     {
-        const void *toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i-1]);
-            lenToHash = 64;
-        }
+        uint512 hash[2];
+        X16RHashAlgo(order[0], data, len, hash[0].begin());
+        for (int i = 1; i < X16R_HASH_COUNT; i++)
+            X16RHashAlgo(order[i], hash[(i - 1) & 1].begin(), hash[0].size(), hash[i & 1].begin());
+        return hash[(X16R_HASH_COUNT - 1) & 1].trim256();
+    }
 
-        hashSelection = GetHashSelection(PrevBlockHash, i);
-
-        switch(hashSelection) {
-            case 0:
-                sph_blake512_init(&ctx_blake);
-                sph_blake512 (&ctx_blake, toHash, lenToHash);
-                sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[i]));
-                break;
-            case 1:
-                sph_bmw512_init(&ctx_bmw);
-                sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-                sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[i]));
-                break;
-            case 2:
-                sph_groestl512_init(&ctx_groestl);
-                sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-                sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[i]));
-                break;
-            case 3:
-                sph_jh512_init(&ctx_jh);
-                sph_jh512 (&ctx_jh, toHash, lenToHash);
-                sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[i]));
-                break;
-            case 4:
-                sph_keccak512_init(&ctx_keccak);
-                sph_keccak512 (&ctx_keccak, toHash, lenToHash);
-                sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[i]));
-                break;
-            case 5:
-                sph_skein512_init(&ctx_skein);
-                sph_skein512 (&ctx_skein, toHash, lenToHash);
-                sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[i]));
-                break;
-            case 6:
-                sph_luffa512_init(&ctx_luffa);
-                sph_luffa512 (&ctx_luffa, toHash, lenToHash);
-                sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[i]));
-                break;
-            case 7:
-                sph_cubehash512_init(&ctx_cubehash);
-                sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-                sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[i]));
-                break;
-            case 8:
-                sph_shavite512_init(&ctx_shavite);
-                sph_shavite512(&ctx_shavite, toHash, lenToHash);
-                sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[i]));
-                break;
-            case 9:
-                sph_simd512_init(&ctx_simd);
-                sph_simd512 (&ctx_simd, toHash, lenToHash);
-                sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[i]));
-                break;
-            case 10:
-                sph_echo512_init(&ctx_echo);
-                sph_echo512 (&ctx_echo, toHash, lenToHash);
-                sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[i]));
-                break;
-           case 11:
-                sph_hamsi512_init(&ctx_hamsi);
-                sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-                sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[i]));
-                break;
-           case 12:
-                sph_fugue512_init(&ctx_fugue);
-                sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-                sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[i]));
-                break;
-           case 13:
-                sph_shabal512_init(&ctx_shabal);
-                sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-                sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[i]));
-                break;
-           case 14:
-                sph_whirlpool_init(&ctx_whirlpool);
-                sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-                sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[i]));
-                break;
-           case 15:
-                sph_sha512_init(&ctx_sha512);
-                sph_sha512 (&ctx_sha512, toHash, lenToHash);
-                sph_sha512_close(&ctx_sha512, static_cast<void*>(&hash[i]));
-                break;
-        }
+    /** Compute the X16R hashes of n messages of len bytes. Faster than n calls
+     *  to Hash(); see X16RHashBatch.
+     */
+    void HashBatch(const unsigned char* const* pdata, size_t len, size_t n, uint256* phash) const
+    {
+        std::vector<unsigned char> vOut(n * X16R_OUTPUT_SIZE);
+        unsigned char (*out)[X16R_OUTPUT_SIZE] = reinterpret_cast<unsigned char (*)[X16R_OUTPUT_SIZE]>(vOut.data());
+        X16RHashBatch(order, pdata, len, n, out);
+        for (size_t j = 0; j < n; j++)
+            memcpy(phash[j].begin(), out[j], phash[j].size());
     }
+};
+
+/** Compute the X16R hash of [pbegin, pend) for a block whose parent is PrevBlockHash. */
+template<typename T1>
+inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+{
+    static unsigned char pblank[1];
 
-    return hash[15].trim256();
+    const unsigned char* data = (pbegin == pend ? pblank : (const unsigned char*)&pbegin[0]);
+    return CX16RPlan(PrevBlockHash).Hash(data, (pend - pbegin) * sizeof(pbegin[0]));
 }
 
 #endif // BITCOIN_HASH_H
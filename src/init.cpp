@@ -18,6 +18,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/x16r.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -49,7 +50,10 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-votedb.h"
 #include "instantx.h"
+#include "messagesigcache.h"
+#include "messagestats.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
 #endif
@@ -231,7 +235,11 @@ void PrepareShutdown()
     CFlatDB<CSafenodePayments> flatdb2("mnpayments.dat", "magicSafenodePaymentsCache");
     flatdb2.Dump(mnpayments);
     CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-    flatdb3.Dump(governance);
+    if(flatdb3.Dump(governance) && pgovernancevotedb) {
+        pgovernancevotedb->WriteClean(true);
+    }
+    delete pgovernancevotedb;
+    pgovernancevotedb = NULL;
     CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
     flatdb4.Dump(netfulfilledman);
 
@@ -385,6 +393,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-checkheaders=<n>", strprintf(_("How many of the most recent block index headers to re-hash at startup, in addition to a random sample of %u (default: %u, -1 = all, implied by -checkblockindex)"), CHECKHEADERS_SAMPLE_SIZE, DEFAULT_CHECKHEADERS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -432,6 +441,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (temporary service connections excluded) (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Number of threads processing peer messages (1 to %d, default: %d)"), MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -543,10 +553,12 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
+        strUsage += HelpMessageOpt("-logmessagestats=<n>", strprintf("Log per command P2P message processing stats every <n> seconds, 0 to disable (default: %u)", DEFAULT_LOG_MESSAGE_STATS_INTERVAL));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxmsgsigcachesize=<n>", strprintf("Limit size of safenode message signature cache to <n> MiB (default: %u)", DEFAULT_MAX_MSG_SIG_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_MIN_RELAY_TX_FEE)));
@@ -1178,6 +1190,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
 
+    // Select the fastest X16R primitives for this CPU
+    std::string strX16RImpl = X16RAutoDetect();
+
     // Sanity check
     if (!InitSanityCheck())
         return InitError(_("Initialization sanity check failed. SafeNode is shutting down."));
@@ -1211,6 +1226,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (fPrintToDebugLog)
         OpenDebugLog();
 
+    LogPrintf("Using X16R implementation: %s\n", strX16RImpl);
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1226,6 +1242,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderCheck);
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1886,6 +1904,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         return InitError("Failed to load safenode cache from mncache.dat");
     }
 
+    // Governance votes are kept in their own database, it only matches governance.dat
+    // if the last shutdown marked it clean, start over with an empty one otherwise
+    bool fGovernanceVotesWiped = false;
+    try {
+        boost::filesystem::create_directories(GetDataDir() / "governance");
+        pgovernancevotedb = new CGovernanceVoteDB(GOVERNANCE_VOTEDB_CACHE);
+        if(!mnodeman.size() || !pgovernancevotedb->IsClean()) {
+            delete pgovernancevotedb;
+            pgovernancevotedb = new CGovernanceVoteDB(GOVERNANCE_VOTEDB_CACHE, false, true);
+            fGovernanceVotesWiped = true;
+        }
+        pgovernancevotedb->WriteClean(false);
+    } catch (const std::exception& e) {
+        return InitError(strprintf("Failed to open governance vote database: %s", e.what()));
+    }
+
     if(mnodeman.size()) {
         uiInterface.InitMessage(_("Loading safenode payment cache..."));
         CFlatDB<CSafenodePayments> flatdb2("mnpayments.dat", "magicSafenodePaymentsCache");
@@ -1898,6 +1932,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         if(!flatdb3.Load(governance)) {
             return InitError("Failed to load governance cache from governance.dat");
         }
+        if(fGovernanceVotesWiped) {
+            // the tallies in governance.dat were made from the wiped votes
+            governance.ClearVotes();
+        }
         governance.InitOnLoad();
     } else {
         uiInterface.InitMessage(_("Safenode cache is empty, skipping payments and governance cache..."));
@@ -1948,6 +1986,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     StartNode(threadGroup, scheduler);
 
+    int64_t nLogMessageStatsInterval = GetArg("-logmessagestats", DEFAULT_LOG_MESSAGE_STATS_INTERVAL);
+    if (nLogMessageStatsInterval > 0)
+        scheduler.scheduleEvery(&LogMessageStats, nLogMessageStatsInterval);
+
     // Monitor the chain, and alert if we get blocks much quicker or slower than expected
     // The "bad chain alert" scheduler has been disabled because the current system gives far
     // too many false positives, such that users are starting to ignore them.
@@ -58,14 +58,23 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
         CTxLockVote vote;
         vRecv >> vote;
 
-        LOCK2(cs_main, cs_instantsend);
-
         uint256 nVoteHash = vote.GetHash();
 
+        {
+            LOCK(cs_instantsend);
+            if(mapTxLockVotes.count(nVoteHash)) return;
+        }
+
+        // Check the signature before taking cs_main so that IsValid() in ProcessTxLockVote()
+        // below doesn't have to. A bad or unverifiable one is checked again and rejected there.
+        bool fSignatureChecked = vote.CheckSignature(false);
+
+        LOCK2(cs_main, cs_instantsend);
+
         if(mapTxLockVotes.count(nVoteHash)) return;
         mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
 
-        ProcessTxLockVote(pfrom, vote);
+        ProcessTxLockVote(pfrom, vote, fSignatureChecked);
 
         return;
     }
@@ -250,13 +259,13 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate)
 }
 
 //received a consensus vote
-bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote)
+bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, bool fSignatureChecked)
 {
     LOCK2(cs_main, cs_instantsend);
 
     uint256 txHash = vote.GetTxHash();
 
-    if(!vote.IsValid(pfrom)) {
+    if(!vote.IsValid(pfrom, fSignatureChecked)) {
         // could be because of missing MN
         LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Vote is invalid, txid=%s\n", txHash.ToString());
         return false;
@@ -946,7 +955,7 @@ bool CTxLockRequest::IsTimedOut() const
 // CTxLockVote
 //
 
-bool CTxLockVote::IsValid(CNode* pnode) const
+bool CTxLockVote::IsValid(CNode* pnode, bool fSignatureChecked) const
 {
     if(!mnodeman.Has(CTxIn(outpointSafenode))) {
         LogPrint("instantsend", "CTxLockVote::IsValid -- Unknown safenode %s\n", outpointSafenode.ToStringShort());
@@ -993,7 +1002,7 @@ bool CTxLockVote::IsValid(CNode* pnode) const
         return false;
     }
 
-    if(!CheckSignature()) {
+    if(!fSignatureChecked && !CheckSignature()) {
         LogPrintf("CTxLockVote::IsValid -- Signature invalid\n");
         return false;
     }
@@ -1010,7 +1019,7 @@ uint256 CTxLockVote::GetHash() const
     return ss.GetHash();
 }
 
-bool CTxLockVote::CheckSignature() const
+bool CTxLockVote::CheckSignature(bool fLog) const
 {
     std::string strError;
     std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
@@ -1018,12 +1027,12 @@ bool CTxLockVote::CheckSignature() const
     safenode_info_t infoMn = mnodeman.GetSafenodeInfo(CTxIn(outpointSafenode));
 
     if(!infoMn.fInfoValid) {
-        LogPrintf("CTxLockVote::CheckSignature -- Unknown Safenode: safenode=%s\n", outpointSafenode.ToString());
+        if(fLog) LogPrintf("CTxLockVote::CheckSignature -- Unknown Safenode: safenode=%s\n", outpointSafenode.ToString());
         return false;
     }
 
     if(!darkSendSigner.VerifyMessage(infoMn.pubKeySafenode, vchSafenodeSignature, strMessage, strError)) {
-        LogPrintf("CTxLockVote::CheckSignature -- VerifyMessage() failed, error: %s\n", strError);
+        if(fLog) LogPrintf("CTxLockVote::CheckSignature -- VerifyMessage() failed, error: %s\n", strError);
         return false;
     }
 
@@ -59,7 +59,7 @@ private:
     void Vote(CTxLockCandidate& txLockCandidate);
 
     //process consensus vote message
-    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote);
+    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, bool fSignatureChecked = false);
     void ProcessOrphanTxLockVotes();
     bool IsEnoughOrphanVotesForTx(const CTxLockRequest& txLockRequest);
     bool IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, const COutPoint& outpoint);
@@ -180,12 +180,12 @@ public:
     COutPoint GetSafenodeOutpoint() const { return outpointSafenode; }
     int64_t GetTimeCreated() const { return nTimeCreated; }
 
-    bool IsValid(CNode* pnode) const;
+    bool IsValid(CNode* pnode, bool fSignatureChecked = false) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(int nHeight) const;
 
     bool Sign();
-    bool CheckSignature() const;
+    bool CheckSignature(bool fLog = true) const;
 
     void Relay() const;
 };
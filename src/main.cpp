@@ -19,6 +19,7 @@
 #include "hash.h"
 #include "init.h"
 #include "merkleblock.h"
+#include "messagestats.h"
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
@@ -1578,6 +1579,41 @@ bool GetAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressIndexPage(uint160 addressHash, int type, int start, int end,
+                         const CAddressIndexKey *pafter, bool fReverse, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(addressHash, type, start, end, pafter, fReverse, nLimit, addressIndex))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
+bool GetAddressBalances(const std::vector<std::pair<uint160, int> > &addresses, CAddressBalanceValue &total)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalances(addresses, total))
+        return error("unable to get balance for addresses");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -1590,6 +1626,31 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int> > &addresses,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndex(addresses, unspentOutputs))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey *pafter,
+                           bool fReverse, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexPage(addressHash, type, pafter, fReverse, nLimit, unspentOutputs))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1682,7 +1743,7 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+static bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, const CBlockIndex* pindex)
 {
     block.SetNull();
 
@@ -1699,6 +1760,15 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    // A header identical to the one in the block index has the indexed hash,
+    // which was checked when the header was accepted. Skip re-hashing it, this
+    // is a full X16R/NeoScrypt run for every block connected during reindex.
+    if (pindex) {
+        CBlockHeader header = pindex->GetBlockHeader();
+        if (memcmp(BEGIN(header.nVersion), BEGIN(block.nVersion), sizeof(header.vchHashCachedFor)) == 0)
+            block.SetCachedHash(pindex->GetBlockHash());
+    }
+
     // Check the header
     if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
@@ -1706,9 +1776,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    return ReadBlockFromDisk(block, pos, consensusParams, NULL);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams, pindex))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1986,6 +2061,21 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CHeaderPowCheck::operator()() {
+    std::vector<const CBlockHeader*> vpheaders;
+    for (const CBlockHeader* pheader = pbegin; pheader != pend; pheader++)
+        vpheaders.push_back(pheader);
+    CacheBlockHeaderHashes(vpheaders);
+
+    for (const CBlockHeader* pheader = pbegin; pheader != pend; pheader++) {
+        if (pheader != pbegin && pheader->hashPrevBlock != (pheader - 1)->GetHash())
+            return false;
+        if (!CheckProofOfWork(pheader->GetHash(), pheader->nBits, *pparams))
+            return false;
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -2384,6 +2474,13 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CHeaderPowCheck> headercheckqueue(16);
+
+void ThreadHeaderCheck() {
+    RenameThread("safenode-hdrcheck");
+    headercheckqueue.Thread();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -4269,6 +4366,39 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+/**
+ * The block index stores the hash of every header, so loading it does not need
+ * to run X16R/NeoScrypt for each entry. Re-hash the most recent headers plus a
+ * random sample of older ones to detect a corrupted index; all of them are
+ * re-hashed when -checkblockindex is set.
+ */
+static bool VerifyBlockIndexHeaders(const vector<pair<int, CBlockIndex*> >& vSortedByHeight)
+{
+    int64_t nCheckHeaders = GetArg("-checkheaders", DEFAULT_CHECKHEADERS);
+    if (fCheckBlockIndex || nCheckHeaders < 0 || (uint64_t)nCheckHeaders > vSortedByHeight.size())
+        nCheckHeaders = vSortedByHeight.size();
+    size_t nRecentStart = vSortedByHeight.size() - nCheckHeaders;
+
+    std::vector<size_t> vToCheck;
+    vToCheck.reserve(nCheckHeaders + CHECKHEADERS_SAMPLE_SIZE);
+    for (size_t i = nRecentStart; i < vSortedByHeight.size(); i++)
+        vToCheck.push_back(i);
+    for (unsigned int i = 0; i < CHECKHEADERS_SAMPLE_SIZE && nRecentStart > 0; i++)
+        vToCheck.push_back(GetRand(nRecentStart));
+
+    LogPrintf("%s: re-hashing %u of %u block index headers\n", __func__, vToCheck.size(), vSortedByHeight.size());
+    BOOST_FOREACH(size_t i, vToCheck)
+    {
+        boost::this_thread::interruption_point();
+        const CBlockIndex* pindex = vSortedByHeight[i].second;
+        CBlockHeader header = pindex->GetBlockHeader();
+        header.fHashCached = false; // force a real recomputation
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: stored hash does not match header at height %d: %s", __func__, pindex->nHeight, pindex->ToString());
+    }
+    return true;
+}
+
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
@@ -4314,6 +4444,9 @@ bool static LoadBlockIndexDB()
             pindexBestHeader = pindex;
     }
 
+    if (!VerifyBlockIndexHeaders(vSortedByHeight))
+        return false;
+
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
@@ -4363,10 +4496,29 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    // Indexes written with the fixed width key layout are moved to the compact one once
+    if (pblocktree->ReadIndexVersion() < INDEX_VERSION) {
+        LogPrintf("%s: upgrading address and spent indexes to key layout version %d...\n", __func__, INDEX_VERSION);
+        if (!pblocktree->UpgradeIndexes())
+            return error("%s: failed to upgrade address and spent indexes", __func__);
+    }
+
     // Check whether we have an address index
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Address indexes created before balances were kept need them built once
+    if (fAddressIndex) {
+        bool fAddressBalanceIndex = false;
+        pblocktree->ReadFlag("addressbalanceindex", fAddressBalanceIndex);
+        if (!fAddressBalanceIndex) {
+            LogPrintf("%s: building address balance index...\n", __func__);
+            if (!pblocktree->BuildAddressBalanceIndex())
+                return error("%s: failed to build address balance index", __func__);
+            pblocktree->WriteFlag("addressbalanceindex", true);
+        }
+    }
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -4539,6 +4691,7 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalanceindex", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -4547,6 +4700,8 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    pblocktree->WriteIndexVersion(INDEX_VERSION);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4576,6 +4731,62 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/**
+ * Process a block read by LoadExternalBlockFile, together with any earlier
+ * encountered blocks that were waiting for it as their parent. Returns false
+ * if the import should be aborted.
+ */
+static bool ImportExternalBlock(const CChainParams& chainparams, CBlock& block, CDiskBlockPos *dbp,
+                                std::multimap<uint256, CDiskBlockPos>& mapBlocksUnknownParent, int& nLoaded)
+{
+    // detect out of order blocks, and store them for later
+    uint256 hash = block.GetHash();
+    if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                block.hashPrevBlock.ToString());
+        if (dbp)
+            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+        return true;
+    }
+
+    // process in case the block isn't known yet
+    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        if (ProcessNewBlock(state, chainparams, NULL, &block, true, dbp))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+            if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus()))
+            {
+                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                        head.ToString());
+                CValidationState dummy;
+                if (ProcessNewBlock(dummy, chainparams, NULL, &block, true, &it->second))
+                {
+                    nLoaded++;
+                    queue.push_back(block.GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+        }
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4587,88 +4798,72 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
+        // Blocks are read in groups of IMPORT_HASH_BATCH so that their headers
+        // can be hashed together (see CacheBlockHeaderHashes) before processing.
+        std::vector<CBlock> vBlocks;
+        std::vector<CDiskBlockPos> vBlockPos;
+        bool fEof = blkdat.eof(), fAbort = false;
+        while (!fEof && !fAbort) {
+            while (!fEof && vBlocks.size() < IMPORT_HASH_BATCH) {
+                boost::this_thread::interruption_point();
+
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[MESSAGE_START_SIZE];
+                    blkdat.FindByte(chainparams.MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE)) {
+                        fEof = blkdat.eof();
+                        continue;
+                    }
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SIZE) {
+                        fEof = blkdat.eof();
+                        continue;
+                    }
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEof = true;
+                    break;
+                }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
                     if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
+                        dbp->nPos = nBlockPos;
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    CBlock block;
+                    blkdat >> block;
+                    nRewind = blkdat.GetPos();
+                    vBlocks.push_back(std::move(block));
+                    vBlockPos.push_back(dbp ? *dbp : CDiskBlockPos());
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
+                fEof = blkdat.eof();
+            }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, chainparams, NULL, &block, true, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
+            std::vector<const CBlockHeader*> vpheaders;
+            for (size_t i = 0; i < vBlocks.size(); i++)
+                vpheaders.push_back(&vBlocks[i]);
+            CacheBlockHeaderHashes(vpheaders);
 
-                // Recursively process earlier encountered successors of this block
-                deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                    head.ToString());
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, chainparams, NULL, &block, true, &it->second))
-                            {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                    }
+            for (size_t i = 0; i < vBlocks.size() && !fAbort; i++) {
+                try {
+                    fAbort = !ImportExternalBlock(chainparams, vBlocks[i], dbp ? &vBlockPos[i] : NULL, mapBlocksUnknownParent, nLoaded);
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            vBlocks.clear();
+            vBlockPos.clear();
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
@@ -4993,10 +5188,10 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         }
 
     case MSG_SAFENODE_ANNOUNCE:
-        return mnodeman.mapSeenSafenodeBroadcast.count(inv.hash) && !mnodeman.IsMnbRecoveryRequested(inv.hash);
+        return mnodeman.mapSeenSafenodeBroadcast.HasKey(inv.hash) && !mnodeman.IsMnbRecoveryRequested(inv.hash);
 
     case MSG_SAFENODE_PING:
-        return mnodeman.mapSeenSafenodePing.count(inv.hash);
+        return mnodeman.mapSeenSafenodePing.HasKey(inv.hash);
 
     case MSG_DSTX:
         return mapDarksendBroadcastTxes.count(inv.hash);
@@ -5006,7 +5201,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         return ! governance.ConfirmInventoryRequest(inv);
 
     case MSG_SAFENODE_VERIFY:
-        return mnodeman.mapSeenSafenodeVerification.count(inv.hash);
+        return mnodeman.mapSeenSafenodeVerification.HasKey(inv.hash);
     }
 
     // Don't know what it is, just say we already got one
@@ -5198,20 +5393,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!pushed && inv.type == MSG_SAFENODE_ANNOUNCE) {
-                    if(mnodeman.mapSeenSafenodeBroadcast.count(inv.hash)){
+                    std::pair<int64_t, CSafenodeBroadcast> mnbSeen;
+                    if(mnodeman.mapSeenSafenodeBroadcast.Get(inv.hash, mnbSeen)){
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << mnodeman.mapSeenSafenodeBroadcast[inv.hash].second;
+                        ss << mnbSeen.second;
                         pfrom->PushMessage(NetMsgType::MNANNOUNCE, ss);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_SAFENODE_PING) {
-                    if(mnodeman.mapSeenSafenodePing.count(inv.hash)) {
+                    CSafenodePing mnp;
+                    if(mnodeman.mapSeenSafenodePing.Get(inv.hash, mnp)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << mnodeman.mapSeenSafenodePing[inv.hash];
+                        ss << mnp;
                         pfrom->PushMessage(NetMsgType::MNPING, ss);
                         pushed = true;
                     }
@@ -5265,10 +5462,11 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!pushed && inv.type == MSG_SAFENODE_VERIFY) {
-                    if(mnodeman.mapSeenSafenodeVerification.count(inv.hash)) {
+                    CSafenodeVerification mnv;
+                    if(mnodeman.mapSeenSafenodeVerification.Get(inv.hash, mnv)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << mnodeman.mapSeenSafenodeVerification[inv.hash];
+                        ss << mnv;
                         pfrom->PushMessage(NetMsgType::MNVERIFY, ss);
                         pushed = true;
                     }
@@ -5300,6 +5498,168 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     }
 }
 
+//
+// Safenode, governance, InstantSend, mixing and spork messages
+//
+
+typedef void (*ExtMessageHandler)(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
+
+/**
+ * Message handler threads hold this while processing anything but the few messages
+ * whose handlers only touch state behind their own locks, see CExtMessageDispatcher.
+ * Lock order: after the peer's cs_vRecvMsg, before everything else.
+ * SendMessages doesn't take it, the peer state it shares with handlers of other peers
+ * is behind cs_addrSend and cs_inventory, the rest behind cs_main.
+ */
+static CCriticalSection cs_serialmessages;
+
+static void ProcessDarksendMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    darkSendPool.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessSafenodeListMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    mnodeman.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessSafenodePaymentsMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    mnpayments.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessInstantSendMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    instantsend.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessSporkMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    sporkManager.ProcessSpork(pfrom, strCommand, vRecv);
+}
+
+static void ProcessSafenodeSyncMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    safenodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessGovernanceMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    governance.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+/**
+ * Routes each extension message to the single manager that handles its command,
+ * instead of offering it to every manager in turn. Commands are interned to
+ * small ids when registered, handlers are looked up by id.
+ *
+ * Handlers registered as concurrent run without cs_serialmessages, in parallel
+ * with messages from peers served by other message handler threads.
+ */
+class CExtMessageDispatcher
+{
+private:
+    struct handler_t {
+        std::string strCommand;
+        ExtMessageHandler handler;
+        bool fConcurrent;
+    };
+
+    boost::unordered_map<std::string, int> mapCommandIds;
+    std::vector<handler_t> vecHandlers;
+
+public:
+    CExtMessageDispatcher()
+    {
+        Register(NetMsgType::DSACCEPT, &ProcessDarksendMessage);
+        Register(NetMsgType::DSQUEUE, &ProcessDarksendMessage);
+        Register(NetMsgType::DSVIN, &ProcessDarksendMessage);
+        Register(NetMsgType::DSSTATUSUPDATE, &ProcessDarksendMessage);
+        Register(NetMsgType::DSSIGNFINALTX, &ProcessDarksendMessage);
+        Register(NetMsgType::DSFINALTX, &ProcessDarksendMessage);
+        Register(NetMsgType::DSCOMPLETE, &ProcessDarksendMessage);
+
+        Register(NetMsgType::MNANNOUNCE, &ProcessSafenodeListMessage);
+        Register(NetMsgType::MNPING, &ProcessSafenodeListMessage);
+        Register(NetMsgType::DSEG, &ProcessSafenodeListMessage);
+        Register(NetMsgType::MNVERIFY, &ProcessSafenodeListMessage);
+
+        Register(NetMsgType::SAFENODEPAYMENTSYNC, &ProcessSafenodePaymentsMessage);
+        Register(NetMsgType::SAFENODEPAYMENTVOTE, &ProcessSafenodePaymentsMessage);
+
+        Register(NetMsgType::TXLOCKVOTE, &ProcessInstantSendMessage, true);
+
+        Register(NetMsgType::SPORK, &ProcessSporkMessage);
+        Register(NetMsgType::GETSPORKS, &ProcessSporkMessage, true);
+
+        Register(NetMsgType::SYNCSTATUSCOUNT, &ProcessSafenodeSyncMessage);
+
+        Register(NetMsgType::MNGOVERNANCESYNC, &ProcessGovernanceMessage);
+        Register(NetMsgType::MNGOVERNANCEOBJECT, &ProcessGovernanceMessage);
+        Register(NetMsgType::MNGOVERNANCEOBJECTVOTE, &ProcessGovernanceMessage);
+        Register(NetMsgType::MNGOVERNANCEDIGEST, &ProcessGovernanceMessage);
+    }
+
+    void Register(const std::string& strCommand, ExtMessageHandler handler, bool fConcurrent = false)
+    {
+        assert(!mapCommandIds.count(strCommand));
+        handler_t h;
+        h.strCommand = strCommand;
+        h.handler = handler;
+        h.fConcurrent = fConcurrent;
+        mapCommandIds.insert(std::make_pair(strCommand, (int)vecHandlers.size()));
+        vecHandlers.push_back(h);
+    }
+
+    /// Returns false if no handler is registered for this command
+    bool Dispatch(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+    {
+        // registration is done in the constructor, lookups need no lock
+        boost::unordered_map<std::string, int>::const_iterator it = mapCommandIds.find(strCommand);
+        if (it == mapCommandIds.end())
+            return false;
+        vecHandlers[it->second].handler(pfrom, strCommand, vRecv);
+        return true;
+    }
+
+    /// Can this command be processed without cs_serialmessages?
+    bool IsConcurrent(const std::string& strCommand) const
+    {
+        boost::unordered_map<std::string, int>::const_iterator it = mapCommandIds.find(strCommand);
+        return it != mapCommandIds.end() && vecHandlers[it->second].fConcurrent;
+    }
+};
+
+static CExtMessageDispatcher& GetExtMessageDispatcher()
+{
+    static CExtMessageDispatcher extMessageDispatcher;
+    return extMessageDispatcher;
+}
+
+/**
+ * Accept one header of a HEADERS message, it must connect to *ppindexLast if
+ * that is set. Returns false, after scoring the peer, if the header is bad.
+ */
+static bool ProcessHeadersMessageHeader(CNode* pfrom, const CBlockHeader& header, const CChainParams& chainparams, CBlockIndex** ppindexLast)
+{
+    AssertLockHeld(cs_main);
+    CValidationState state;
+    if (*ppindexLast != NULL && header.hashPrevBlock != (*ppindexLast)->GetBlockHash()) {
+        Misbehaving(pfrom->GetId(), 20);
+        return error("non-continuous headers sequence");
+    }
+    if (!AcceptBlockHeader(header, state, chainparams, ppindexLast)) {
+        int nDoS;
+        if (state.IsInvalid(nDoS)) {
+            if (nDoS > 0)
+                Misbehaving(pfrom->GetId(), nDoS);
+            std::string strError = "invalid header received " + header.GetHash().ToString();
+            return error(strError.c_str());
+        }
+    }
+    return true;
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -5984,31 +6344,52 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
-        LOCK(cs_main);
-
         if (nCount == 0) {
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
 
+        // Accept the first header on its own, so that a batch which doesn't
+        // connect or is invalid from the start costs a single hash.
         CBlockIndex *pindexLast = NULL;
-        BOOST_FOREACH(const CBlockHeader& header, headers) {
-            CValidationState state;
-            if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetId(), 20);
-                return error("non-continuous headers sequence");
+        {
+            LOCK(cs_main);
+            if (!ProcessHeadersMessageHeader(pfrom, headers[0], chainparams, &pindexLast))
+                return false;
+        }
+
+        // Hash and check the proof of work and continuity of the rest of the
+        // batch before taking cs_main again, AcceptBlockHeader() below then finds
+        // the hashes memoized. The first bad run of headers stops the pass, the
+        // serial pass stops at the same header and gives it the proper DoS score.
+        if (nCount > 2) {
+            std::vector<CHeaderPowCheck> vChecks;
+            vChecks.reserve((nCount - 1 + HEADER_CHECK_BATCH - 1) / HEADER_CHECK_BATCH);
+            for (unsigned int n = 1; n < nCount; n += HEADER_CHECK_BATCH) {
+                const CBlockHeader* pbegin = &headers[n];
+                vChecks.push_back(CHeaderPowCheck(pbegin, pbegin + std::min(HEADER_CHECK_BATCH, nCount - n), chainparams.GetConsensus()));
             }
-            if (!AcceptBlockHeader(header, state, chainparams, &pindexLast)) {
-                int nDoS;
-                if (state.IsInvalid(nDoS)) {
-                    if (nDoS > 0)
-                        Misbehaving(pfrom->GetId(), nDoS);
-                    std::string strError = "invalid header received " + header.GetHash().ToString();
-                    return error(strError.c_str());
+            if (nScriptCheckThreads) {
+                // the queue hands out checks from the back, start with the earliest headers
+                std::reverse(vChecks.begin(), vChecks.end());
+                CCheckQueueControl<CHeaderPowCheck> control(&headercheckqueue);
+                control.Add(vChecks);
+                control.Wait();
+            } else {
+                BOOST_FOREACH(CHeaderPowCheck& check, vChecks) {
+                    if (!check())
+                        break;
                 }
             }
         }
 
+        LOCK(cs_main);
+
+        for (unsigned int n = 1; n < nCount; n++) {
+            if (!ProcessHeadersMessageHeader(pfrom, headers[n], chainparams, &pindexLast))
+                return false;
+        }
+
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
@@ -6113,7 +6494,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             return true;
         }
 
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrSend);
+            pfrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         BOOST_FOREACH(const CAddress &addr, vAddr)
             pfrom->PushAddress(addr);
@@ -6335,30 +6719,23 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
     else
     {
-        bool found = false;
-        const std::vector<std::string> &allMessages = getAllNetMessageTypes();
-        BOOST_FOREACH(const std::string msg, allMessages) {
-            if(msg == strCommand) {
-                found = true;
-                break;
+        //probably one the extensions
+        if (!GetExtMessageDispatcher().Dispatch(pfrom, strCommand, vRecv))
+        {
+            bool found = false;
+            const std::vector<std::string> &allMessages = getAllNetMessageTypes();
+            BOOST_FOREACH(const std::string msg, allMessages) {
+                if(msg == strCommand) {
+                    found = true;
+                    break;
+                }
             }
-        }
 
-        if (found)
-        {
-            //probably one the extensions
-            darkSendPool.ProcessMessage(pfrom, strCommand, vRecv);
-            mnodeman.ProcessMessage(pfrom, strCommand, vRecv);
-            mnpayments.ProcessMessage(pfrom, strCommand, vRecv);
-            instantsend.ProcessMessage(pfrom, strCommand, vRecv);
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv);
-            safenodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv);
-        }
-        else
-        {
-            // Ignore unknown commands for extensibility
-            LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
+            if (!found)
+            {
+                // Ignore unknown commands for extensibility
+                LogPrint("net", "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->id);
+            }
         }
     }
 
@@ -6382,8 +6759,10 @@ bool ProcessMessages(CNode* pfrom)
     //
     bool fOk = true;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        LOCK(cs_serialmessages);
         ProcessGetData(pfrom, chainparams.GetConsensus());
+    }
 
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
@@ -6441,9 +6820,16 @@ bool ProcessMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        int64_t nTimeStart = GetTimeMicros();
+        int64_t nLockWaitStart = GetThreadLockWaitTime();
         try
         {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            if (GetExtMessageDispatcher().IsConcurrent(strCommand)) {
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            } else {
+                LOCK(cs_serialmessages);
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            }
             boost::this_thread::interruption_point();
         }
         catch (const std::ios_base::failure& e)
@@ -6473,6 +6859,9 @@ bool ProcessMessages(CNode* pfrom)
             PrintExceptionContinue(NULL, "ProcessMessages()");
         }
 
+        int64_t nTimeEnd = GetTimeMicros();
+        RecordMessageStats(strCommand, nMessageSize, nTimeStart - msg.nTime, nTimeEnd - nTimeStart, GetThreadLockWaitTime() - nLockWaitStart);
+
         if (!fRet)
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
 
@@ -6540,6 +6929,7 @@ bool SendMessages(CNode* pto)
         //
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            LOCK(pto->cs_addrSend);
             vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             BOOST_FOREACH(const CAddress& addr, pto->vAddrToSend)
@@ -181,6 +181,14 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
 static const signed int DEFAULT_CHECKBLOCKS = MIN_BLOCKS_TO_KEEP;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+/** Number of most recent block index headers re-hashed against their stored hash at startup */
+static const signed int DEFAULT_CHECKHEADERS = MIN_BLOCKS_TO_KEEP;
+/** Number of additional randomly sampled block index headers re-hashed at startup */
+static const unsigned int CHECKHEADERS_SAMPLE_SIZE = 100;
+/** Number of consecutive headers each CHeaderPowCheck hashes as one batch */
+static const unsigned int HEADER_CHECK_BATCH = 4;
+/** Number of blocks read ahead during import/reindex so their headers can be hashed as one batch */
+static const unsigned int IMPORT_HASH_BATCH = 4;
 
 // Require that user allocate at least 550MB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
@@ -236,6 +244,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof-of-work checking thread */
+void ThreadHeaderCheck();
 
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
@@ -381,21 +391,21 @@ struct CAddressUnspentKey {
     size_t index;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 57;
+        return 53 + GetSizeOfOrderedVarInt(index);
     }
     template<typename Stream>
     void Serialize(Stream& s, int nType, int nVersion) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s, nType, nVersion);
         txhash.Serialize(s, nType, nVersion);
-        ser_writedata32(s, index);
+        WriteOrderedVarInt(s, index);
     }
     template<typename Stream>
     void Unserialize(Stream& s, int nType, int nVersion) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s, nType, nVersion);
         txhash.Unserialize(s, nType, nVersion);
-        index = ser_readdata32(s);
+        index = ReadOrderedVarInt(s);
     }
 
     CAddressUnspentKey(unsigned int addressType, uint160 addressHash, uint256 txid, size_t indexValue) {
@@ -452,6 +462,32 @@ struct CAddressUnspentValue {
     }
 };
 
+/** Running totals of the address index rows of an address, keyed by CAddressIndexIteratorKey */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t txcount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txcount);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txcount = 0;
+    }
+};
+
 struct CAddressIndexKey {
     unsigned int type;
     uint160 hashBytes;
@@ -462,30 +498,29 @@ struct CAddressIndexKey {
     bool spending;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 66;
+        return 53 + GetSizeOfOrderedVarInt((uint32_t)blockHeight) + GetSizeOfOrderedVarInt(txindex) +
+               GetSizeOfOrderedVarInt(((uint64_t)index << 1) | spending);
     }
     template<typename Stream>
     void Serialize(Stream& s, int nType, int nVersion) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s, nType, nVersion);
-        // Heights are stored big-endian for key sorting in LevelDB
-        ser_writedata32be(s, blockHeight);
-        ser_writedata32be(s, txindex);
+        // Heights are stored as ordered varints for key sorting in LevelDB
+        WriteOrderedVarInt(s, (uint32_t)blockHeight);
+        WriteOrderedVarInt(s, txindex);
         txhash.Serialize(s, nType, nVersion);
-        ser_writedata32(s, index);
-        char f = spending;
-        ser_writedata8(s, f);
+        WriteOrderedVarInt(s, ((uint64_t)index << 1) | spending);
     }
     template<typename Stream>
     void Unserialize(Stream& s, int nType, int nVersion) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s, nType, nVersion);
-        blockHeight = ser_readdata32be(s);
-        txindex = ser_readdata32be(s);
+        blockHeight = ReadOrderedVarInt(s);
+        txindex = ReadOrderedVarInt(s);
         txhash.Unserialize(s, nType, nVersion);
-        index = ser_readdata32(s);
-        char f = ser_readdata8(s);
-        spending = f;
+        uint64_t nIndex = ReadOrderedVarInt(s);
+        index = nIndex >> 1;
+        spending = nIndex & 1;
     }
 
     CAddressIndexKey(unsigned int addressType, uint160 addressHash, int height, int blockindex,
@@ -554,19 +589,19 @@ struct CAddressIndexIteratorHeightKey {
     int blockHeight;
 
     size_t GetSerializeSize(int nType, int nVersion) const {
-        return 25;
+        return 21 + GetSizeOfOrderedVarInt((uint32_t)blockHeight);
     }
     template<typename Stream>
     void Serialize(Stream& s, int nType, int nVersion) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s, nType, nVersion);
-        ser_writedata32be(s, blockHeight);
+        WriteOrderedVarInt(s, (uint32_t)blockHeight);
     }
     template<typename Stream>
     void Unserialize(Stream& s, int nType, int nVersion) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s, nType, nVersion);
-        blockHeight = ser_readdata32be(s);
+        blockHeight = ReadOrderedVarInt(s);
     }
 
     CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, int height) {
@@ -716,13 +751,51 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the proof-of-work and continuity check of a run of
+ * consecutive block headers. Computing the X16R/NeoScrypt hash is by far the
+ * most expensive part of header validation; running these on the header check
+ * queue memoizes the hashes in the headers (see CBlockHeader::GetHash) before
+ * cs_main is taken. A failed check makes the queue skip the remaining runs.
+ */
+class CHeaderPowCheck
+{
+private:
+    const CBlockHeader *pbegin;
+    const CBlockHeader *pend;
+    const Consensus::Params *pparams;
+
+public:
+    CHeaderPowCheck(): pbegin(0), pend(0), pparams(0) {}
+    CHeaderPowCheck(const CBlockHeader* pbeginIn, const CBlockHeader* pendIn, const Consensus::Params& paramsIn) :
+        pbegin(pbeginIn), pend(pendIn), pparams(&paramsIn) { }
+
+    bool operator()();
+
+    void swap(CHeaderPowCheck &check) {
+        std::swap(pbegin, check.pbegin);
+        std::swap(pend, check.pend);
+        std::swap(pparams, check.pparams);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                      int start = 0, int end = 0);
+bool GetAddressIndexPage(uint160 addressHash, int type, int start, int end,
+                         const CAddressIndexKey *pafter, bool fReverse, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance);
+bool GetAddressBalances(const std::vector<std::pair<uint160, int> > &addresses, CAddressBalanceValue &total);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int> > &addresses,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey *pafter,
+                           bool fReverse, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -0,0 +1,146 @@
+// Copyright (c) 2009-2015 The Bitcoin Core developers
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigcache.h"
+
+#include "crypto/sha256.h"
+#include "memusage.h"
+#include "pubkey.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <atomic>
+
+#include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace {
+
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ */
+class CMessageSigCacheHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/**
+ * Good signature cache for the compact signatures of safenode, governance,
+ * InstantSend and mixing messages, so that a message relayed to us by several
+ * peers, or reprocessed later on, costs only one public key recovery.
+ * Modeled on the script signature cache.
+ */
+class CMessageSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || message hash || key id || signature):
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, CMessageSigCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_msgsigcache;
+
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+public:
+    CMessageSignatureCache()
+        : nHits(0),
+          nMisses(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+    {
+        CSHA256 hasher;
+        hasher.Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size());
+        if (!vchSig.empty()) {
+            hasher.Write(&vchSig[0], vchSig.size());
+        }
+        hasher.Finalize(entry.begin());
+    }
+
+    bool
+    Get(const uint256& entry)
+    {
+        bool fFound;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_msgsigcache);
+            fFound = setValid.count(entry);
+        }
+        if (fFound) {
+            ++nHits;
+        } else {
+            ++nMisses;
+        }
+        return fFound;
+    }
+
+    void Set(const uint256& entry)
+    {
+        size_t nMaxCacheSize = GetArg("-maxmsgsigcachesize", DEFAULT_MAX_MSG_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+        {
+            map_type::size_type s = GetRand(setValid.bucket_count());
+            map_type::local_iterator it = setValid.begin(s);
+            if (it != setValid.end(s)) {
+                setValid.erase(*it);
+            }
+        }
+
+        setValid.insert(entry);
+    }
+
+    message_sig_cache_stats_t GetStats()
+    {
+        message_sig_cache_stats_t stats;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_msgsigcache);
+            stats.nEntries = setValid.size();
+            stats.nMemoryUsage = memusage::DynamicUsage(setValid);
+        }
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        return stats;
+    }
+};
+
+CMessageSignatureCache& GetMessageSignatureCache()
+{
+    static CMessageSignatureCache messageSignatureCache;
+    return messageSignatureCache;
+}
+
+}
+
+bool IsMessageSignatureCached(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+{
+    CMessageSignatureCache& messageSignatureCache = GetMessageSignatureCache();
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, vchSig, keyID);
+    return messageSignatureCache.Get(entry);
+}
+
+void AddMessageSignatureToCache(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+{
+    CMessageSignatureCache& messageSignatureCache = GetMessageSignatureCache();
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, vchSig, keyID);
+    messageSignatureCache.Set(entry);
+}
+
+message_sig_cache_stats_t GetMessageSigCacheStats()
+{
+    return GetMessageSignatureCache().GetStats();
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MESSAGESIGCACHE_H
+#define MESSAGESIGCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class CKeyID;
+class uint256;
+
+// Limit size of the cache of good safenode/governance/mixing message signatures
+static const unsigned int DEFAULT_MAX_MSG_SIG_CACHE_SIZE = 8;
+
+struct message_sig_cache_stats_t {
+    size_t nEntries;
+    size_t nMemoryUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/// Was this signature of the message hash by the key already found to be good?
+bool IsMessageSignatureCached(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID);
+/// Remember a good signature of the message hash by the key
+void AddMessageSignatureToCache(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID);
+
+message_sig_cache_stats_t GetMessageSigCacheStats();
+
+#endif // MESSAGESIGCACHE_H
@@ -0,0 +1,111 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagestats.h"
+
+#include "protocol.h"
+#include "sync.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <set>
+
+#include <boost/foreach.hpp>
+
+namespace {
+
+CCriticalSection cs_messagestats;
+
+std::map<std::string, CMessageStats> mapMessageStats;
+
+bool IsKnownCommand(const std::string& strCommand)
+{
+    static const std::vector<std::string>& vAllMessages = getAllNetMessageTypes();
+    static const std::set<std::string> setAllMessages(vAllMessages.begin(), vAllMessages.end());
+    return setAllMessages.count(strCommand);
+}
+
+} // anon namespace
+
+CTimeHistogram::CTimeHistogram()
+    : nCount(0),
+      nTotalMicros(0),
+      nMaxMicros(0)
+{
+    for(int i = 0; i < BUCKETS; ++i)
+        vBuckets[i] = 0;
+}
+
+void CTimeHistogram::Add(int64_t nMicros)
+{
+    if(nMicros < 0) nMicros = 0;
+    vBuckets[GetBucket(nMicros)]++;
+    nCount++;
+    nTotalMicros += nMicros;
+    if(nMicros > nMaxMicros) nMaxMicros = nMicros;
+}
+
+int CTimeHistogram::GetBucket(int64_t nMicros)
+{
+    int nBucket = 0;
+    int64_t nLimit = 10;
+    while(nBucket < BUCKETS - 1 && nMicros >= nLimit) {
+        nLimit *= 10;
+        nBucket++;
+    }
+    return nBucket;
+}
+
+int64_t CTimeHistogram::GetBucketLimit(int nBucket)
+{
+    if(nBucket >= BUCKETS - 1) return -1;
+    int64_t nLimit = 10;
+    for(int i = 0; i < nBucket; ++i)
+        nLimit *= 10;
+    return nLimit;
+}
+
+void RecordMessageStats(const std::string& strCommand, uint64_t nBytes, int64_t nQueueMicros, int64_t nProcessMicros, int64_t nLockWaitMicros)
+{
+    LOCK(cs_messagestats);
+    std::map<std::string, CMessageStats>::iterator it = mapMessageStats.find(strCommand);
+    if(it == mapMessageStats.end()) {
+        const std::string strKey = IsKnownCommand(strCommand) ? strCommand : std::string("unknown");
+        it = mapMessageStats.insert(std::make_pair(strKey, CMessageStats())).first;
+    }
+    CMessageStats& stats = it->second;
+    stats.nCount++;
+    stats.nBytes += nBytes;
+    stats.histQueue.Add(nQueueMicros);
+    stats.histProcess.Add(nProcessMicros);
+    stats.histLockWait.Add(nLockWaitMicros);
+}
+
+void GetMessageStats(std::map<std::string, CMessageStats>& mapStatsRet)
+{
+    LOCK(cs_messagestats);
+    mapStatsRet = mapMessageStats;
+}
+
+void ResetMessageStats()
+{
+    LOCK(cs_messagestats);
+    mapMessageStats.clear();
+}
+
+void LogMessageStats()
+{
+    std::map<std::string, CMessageStats> mapStats;
+    GetMessageStats(mapStats);
+
+    LogPrintf("Message stats, %u commands:\n", mapStats.size());
+    BOOST_FOREACH(const PAIRTYPE(std::string, CMessageStats)& pair, mapStats) {
+        const CMessageStats& stats = pair.second;
+        LogPrintf("  %-20s count=%u bytes=%u queue=%.3fms/%.3fms process=%.3fms/%.3fms lockwait=%.3fms/%.3fms (avg/max)\n",
+                  pair.first, stats.nCount, stats.nBytes,
+                  stats.histQueue.nTotalMicros * 0.001 / stats.nCount, stats.histQueue.nMaxMicros * 0.001,
+                  stats.histProcess.nTotalMicros * 0.001 / stats.nCount, stats.histProcess.nMaxMicros * 0.001,
+                  stats.histLockWait.nTotalMicros * 0.001 / stats.nCount, stats.histLockWait.nMaxMicros * 0.001);
+    }
+}
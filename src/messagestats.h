@@ -0,0 +1,64 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MESSAGESTATS_H
+#define MESSAGESTATS_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+// Log message processing stats every <n> seconds, 0 = never
+static const int64_t DEFAULT_LOG_MESSAGE_STATS_INTERVAL = 0;
+
+/**
+ * Distribution of durations over fixed decade wide buckets:
+ * below 10us, 100us, 1ms, 10ms, 100ms, 1s, 10s and the rest.
+ */
+class CTimeHistogram
+{
+public:
+    static const int BUCKETS = 8;
+
+    uint64_t vBuckets[BUCKETS];
+    uint64_t nCount;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+
+    CTimeHistogram();
+
+    void Add(int64_t nMicros);
+
+    /// Bucket a duration falls in
+    static int GetBucket(int64_t nMicros);
+    /// Exclusive upper bound of the bucket in microseconds, -1 for the last one
+    static int64_t GetBucketLimit(int nBucket);
+};
+
+/** Everything recorded for one message command since startup */
+struct CMessageStats
+{
+    uint64_t nCount;
+    uint64_t nBytes;
+    // from receipt of the full message to the start of its processing
+    CTimeHistogram histQueue;
+    // spent in ProcessMessage
+    CTimeHistogram histProcess;
+    // spent blocked on contended locks (cs_main mostly) while processing
+    CTimeHistogram histLockWait;
+
+    CMessageStats() : nCount(0), nBytes(0) {}
+};
+
+/// Commands we don't know about are all recorded as "unknown" so peers can't grow the stats
+void RecordMessageStats(const std::string& strCommand, uint64_t nBytes, int64_t nQueueMicros, int64_t nProcessMicros, int64_t nLockWaitMicros);
+
+void GetMessageStats(std::map<std::string, CMessageStats>& mapStatsRet);
+
+void ResetMessageStats();
+
+/// Write a line per command to debug.log
+void LogMessageStats();
+
+#endif // MESSAGESTATS_H
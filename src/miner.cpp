@@ -457,12 +457,17 @@ void static BitcoinMiner(const CChainParams& chainparams)
             {
                 unsigned int nHashesDone = 0;
 
-                uint256 hash;
+                uint256 hashes[MINER_HASH_BATCH];
                 while (true)
                 {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
+                    pblock->GetHashesForNonces(MINER_HASH_BATCH, hashes);
+                    unsigned int i = 0;
+                    while (i < MINER_HASH_BATCH && UintToArith256(hashes[i]) > hashTarget)
+                        i++;
+                    if (i < MINER_HASH_BATCH)
                     {
+                        pblock->nNonce += i;
+                        const uint256& hash = hashes[i];
                         // Found a solution
                         SetThreadPriority(THREAD_PRIORITY_NORMAL);
                         LogPrintf("SafeNodeMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
@@ -477,9 +482,9 @@ void static BitcoinMiner(const CChainParams& chainparams)
 
                         break;
                     }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
+                    pblock->nNonce += MINER_HASH_BATCH;
+                    nHashesDone += MINER_HASH_BATCH;
+                    if ((pblock->nNonce & 0xFF) < MINER_HASH_BATCH)
                         break;
                 }
 
@@ -19,6 +19,8 @@ namespace Consensus { struct Params; };
 
 static const bool DEFAULT_GENERATE = false;
 static const int DEFAULT_GENERATE_THREADS = 1;
+/** Number of consecutive nonces the internal miner hashes as one batch */
+static const unsigned int MINER_HASH_BATCH = 8;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
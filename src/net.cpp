@@ -703,7 +703,8 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            // wake the handler this peer is pinned to, we don't know which one it is
+            messageHandlerCondition.notify_all();
         }
     }
 
@@ -1738,7 +1739,11 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
-void ThreadMessageHandler()
+/**
+ * One of nWorkers message handler threads. Each peer is served by the worker its id maps to,
+ * so messages from one peer are still processed (and answered) in order.
+ */
+void ThreadMessageHandler(int nWorker, int nWorkers)
 {
     boost::mutex condition_mutex;
     boost::unique_lock<boost::mutex> lock(condition_mutex);
@@ -1752,6 +1757,9 @@ void ThreadMessageHandler()
 
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
+            if (pnode->GetId() % nWorkers != nWorker)
+                continue;
+
             if (pnode->fDisconnect)
                 continue;
 
@@ -2010,7 +2018,12 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "mnbcon", &ThreadMnbRequestConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int nMessageHandlerThreads = std::max(1, std::min((int)GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS), MAX_MSGHANDLER_THREADS));
+    LogPrintf("Using %d message handler threads\n", nMessageHandlerThreads);
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        boost::function<void()> fn = boost::bind(&ThreadMessageHandler, i, nMessageHandlerThreads);
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "msghand", fn));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpData, DUMP_ADDRESSES_INTERVAL);
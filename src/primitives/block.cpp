@@ -12,16 +12,95 @@
 #include "crypto/common.h"
 #include "crypto/neoscrypt.h"
 
+#include <boost/thread/tss.hpp>
+
+static const uint32_t NEOSCRYPT_LAST_TIME = 1522584000; // 2018/04/01 @ 12:00 (UTC)
+
+/** Number of X16R plans each thread keeps, indexed by the low bits of hashPrevBlock */
+static const unsigned int X16R_PLAN_CACHE_SIZE = 8;
+
+/**
+ * The X16R plan for hashPrevBlock from a small per-thread cache. The miner,
+ * getblocktemplate and block validation hash the same few parents over and
+ * over, and a per-thread cache needs no lock.
+ */
+static const CX16RPlan& GetX16RPlan(const uint256& hashPrevBlock)
+{
+    static boost::thread_specific_ptr<std::vector<CX16RPlan> > planCache;
+    if (planCache.get() == NULL)
+        planCache.reset(new std::vector<CX16RPlan>(X16R_PLAN_CACHE_SIZE, CX16RPlan(uint256())));
+
+    CX16RPlan& plan = (*planCache)[hashPrevBlock.GetCheapHash() % X16R_PLAN_CACHE_SIZE];
+    if (plan.GetPrevBlockHash() != hashPrevBlock)
+        plan = CX16RPlan(hashPrevBlock);
+    return plan;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
-        uint256 thash;
-        unsigned int profile = 0x0;
-		if(nTime <= 1522584000){ // 2018/04/01 @ 12:00 (UTC)
-        	neoscrypt((unsigned char *) &nVersion, (unsigned char *) &thash, profile);
-        } else {
-			thash = HashX16R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
-		}
-		return thash;
+    if (fHashCached && memcmp(vchHashCachedFor, BEGIN(nVersion), sizeof(vchHashCachedFor)) == 0)
+        return hashCached;
+
+    uint256 thash;
+    unsigned int profile = 0x0;
+    if(nTime <= NEOSCRYPT_LAST_TIME){
+        neoscrypt((unsigned char *) &nVersion, (unsigned char *) &thash, profile);
+    } else {
+        thash = GetX16RPlan(hashPrevBlock).Hash((const unsigned char*)BEGIN(nVersion), sizeof(vchHashCachedFor));
+    }
+    SetCachedHash(thash);
+    return thash;
+}
+
+void CBlockHeader::SetCachedHash(const uint256& hash) const
+{
+    memcpy(vchHashCachedFor, BEGIN(nVersion), sizeof(vchHashCachedFor));
+    hashCached = hash;
+    fHashCached = true;
+}
+
+void CBlockHeader::GetHashesForNonces(unsigned int n, uint256* phash) const
+{
+    CBlockHeader header(*this);
+    if (nTime <= NEOSCRYPT_LAST_TIME) {
+        for (unsigned int i = 0; i < n; i++, header.nNonce++)
+            phash[i] = header.GetHash();
+        return;
+    }
+
+    const size_t nHeaderSize = sizeof(vchHashCachedFor);
+    std::vector<unsigned char> vData(n * nHeaderSize);
+    std::vector<const unsigned char*> vpData(n);
+    for (unsigned int i = 0; i < n; i++, header.nNonce++) {
+        memcpy(&vData[i * nHeaderSize], BEGIN(header.nVersion), nHeaderSize);
+        vpData[i] = &vData[i * nHeaderSize];
+    }
+    GetX16RPlan(hashPrevBlock).HashBatch(vpData.data(), nHeaderSize, n, phash);
+}
+
+void CacheBlockHeaderHashes(const std::vector<const CBlockHeader*>& vpheaders)
+{
+    std::vector<const CBlockHeader*> vNeoScrypt;
+    for (size_t i = 0; i < vpheaders.size(); i++) {
+        if (vpheaders[i]->nTime <= NEOSCRYPT_LAST_TIME)
+            vNeoScrypt.push_back(vpheaders[i]);
+        else
+            vpheaders[i]->GetHash();
+    }
+    if (vNeoScrypt.empty())
+        return;
+
+    const size_t nHeaderSize = sizeof(vNeoScrypt[0]->vchHashCachedFor);
+    std::vector<unsigned char> vInput(vNeoScrypt.size() * nHeaderSize);
+    std::vector<unsigned char> vOutput(vNeoScrypt.size() * 32);
+    for (size_t i = 0; i < vNeoScrypt.size(); i++)
+        memcpy(&vInput[i * nHeaderSize], BEGIN(vNeoScrypt[i]->nVersion), nHeaderSize);
+    neoscrypt_batch(vInput.data(), vOutput.data(), vNeoScrypt.size());
+    for (size_t i = 0; i < vNeoScrypt.size(); i++) {
+        uint256 hash;
+        memcpy(hash.begin(), &vOutput[i * 32], 32);
+        vNeoScrypt[i]->SetCachedHash(hash);
+    }
 }
 
 std::string CBlock::ToString() const
@@ -28,6 +28,11 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
+    // memory only
+    mutable uint256 hashCached;
+    mutable unsigned char vchHashCachedFor[80];
+    mutable bool fHashCached;
+
     CBlockHeader()
     {
         SetNull();
@@ -54,6 +59,7 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        fHashCached = false;
     }
 
     bool IsNull() const
@@ -61,8 +67,29 @@ public:
         return (nBits == 0);
     }
 
+    /**
+     * Returns the PoW hash of the header. The result is memoized together with
+     * the header bytes it was computed over, so modifying any header field
+     * (e.g. the miner bumping nNonce) transparently invalidates the cache.
+     * Not thread safe: a single header must not be hashed concurrently.
+     */
     uint256 GetHash() const;
 
+    /**
+     * Seed the hash cache with an already known hash of the current header
+     * fields (e.g. from CBlockIndex), avoiding a recomputation. The caller
+     * is responsible for hash actually matching the header.
+     */
+    void SetCachedHash(const uint256& hash) const;
+
+    /**
+     * Compute the PoW hashes of this header with nNonce, nNonce + 1, ...,
+     * nNonce + n - 1 into phash. X16R headers are hashed as one batch, which
+     * is considerably faster than n calls to GetHash(). Does not touch the
+     * hash cache.
+     */
+    void GetHashesForNonces(unsigned int n, uint256* phash) const;
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
@@ -70,6 +97,12 @@ public:
 };
 
 
+/**
+ * Compute and memoize the PoW hashes of a set of headers. Pre-X16R headers are
+ * hashed four at a time when the 4-way NeoScrypt code is available.
+ */
+void CacheBlockHeaderHashes(const std::vector<const CBlockHeader*>& vpheaders);
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -111,14 +144,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        // slicing copy, keeps the memoized hash
+        return CBlockHeader(*this);
     }
 
     std::string ToString() const;
@@ -116,6 +116,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "prioritisetransaction", 2 },
     { "setban", 2 },
     { "setban", 3 },
+    { "getmessagestats", 0 },
     { "spork", 1 },
     { "voteraw", 1 },
     { "voteraw", 5 },
@@ -9,6 +9,7 @@
 #include "clientversion.h"
 #include "init.h"
 #include "main.h"
+#include "messagesigcache.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpcserver.h"
@@ -262,6 +263,34 @@ UniValue spork(const UniValue& params, bool fHelp)
         + HelpRequiringPassphrase());
 }
 
+UniValue getmsgsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmsgsigcacheinfo\n"
+            "\nReturns information about the cache of good safenode, governance, InstantSend and mixing message signatures.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,           (numeric) Number of cached signatures\n"
+            "  \"usage\": xxxxx,          (numeric) Memory usage of the cache in bytes\n"
+            "  \"hits\": xxxxx,           (numeric) Signatures found in the cache since startup\n"
+            "  \"misses\": xxxxx          (numeric) Signatures not found in the cache since startup\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmsgsigcacheinfo", "")
+            + HelpExampleRpc("getmsgsigcacheinfo", "")
+        );
+
+    message_sig_cache_stats_t stats = GetMessageSigCacheStats();
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("size", (int64_t)stats.nEntries));
+    obj.push_back(Pair("usage", (int64_t)stats.nMemoryUsage));
+    obj.push_back(Pair("hits", (int64_t)stats.nHits));
+    obj.push_back(Pair("misses", (int64_t)stats.nMisses));
+    return obj;
+}
+
 UniValue validateaddress(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -570,6 +599,74 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/** Paging options of the address index calls */
+struct AddressPageParams {
+    size_t limit;
+    std::string after;
+    bool reverse;
+};
+
+/** Returns false if no page was asked for and the whole result should be returned */
+bool getPageFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> > &addresses, AddressPageParams &page)
+{
+    page.limit = 0;
+    page.after = "";
+    page.reverse = false;
+
+    if (!params[0].isObject()) {
+        return false;
+    }
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull()) {
+        return false;
+    }
+    if (!limitValue.isNum() || limitValue.get_int() <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    }
+    if (addresses.size() != 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Paging is only supported for a single address");
+    }
+    page.limit = limitValue.get_int();
+
+    UniValue afterValue = find_value(params[0].get_obj(), "after");
+    if (!afterValue.isNull()) {
+        page.after = afterValue.get_str();
+    }
+    UniValue reverseValue = find_value(params[0].get_obj(), "reverse");
+    if (!reverseValue.isNull()) {
+        page.reverse = reverseValue.get_bool();
+    }
+
+    return true;
+}
+
+/** A cursor is the hex encoded database key of the last entry of a page */
+template<typename K>
+std::string encodeAddressCursor(const K &key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
+template<typename K>
+void decodeAddressCursor(const std::string &cursor, const std::pair<uint160, int> &address, K &key)
+{
+    if (!IsHex(cursor)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    CDataStream ss(ParseHex(cursor), SER_DISK, CLIENT_VERSION);
+    try {
+        ss >> key;
+    } catch (const std::exception&) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (key.type != (unsigned int)address.second || key.hashBytes != address.first) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor doesn't belong to the address");
+    }
+}
+
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -654,6 +751,9 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return a page of at most this many outputs of a single address, by txid\n"
+            "  \"after\" (string, optional) The cursor of the previous page\n"
+            "  \"reverse\" (boolean, optional) Page in descending order\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -666,6 +766,11 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult with limit\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs as above\n"
+            "  \"cursor\"  (string) Pass as \"after\" to get the next page, missing on the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -679,13 +784,25 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+    AddressPageParams page;
+    bool fPaged = getPageFromParams(params, addresses, page);
+
+    if (fPaged) {
+        CAddressUnspentKey after;
+        if (!page.after.empty()) {
+            decodeAddressCursor(page.after, addresses[0], after);
+        }
+        if (!GetAddressUnspentPage(addresses[0].first, addresses[0].second, page.after.empty() ? NULL : &after,
+                                   page.reverse, page.limit, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    } else {
+        if (!GetAddressUnspent(addresses, unspentOutputs)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue result(UniValue::VARR);
 
@@ -705,6 +822,15 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         result.push_back(output);
     }
 
+    if (fPaged) {
+        UniValue pageResult(UniValue::VOBJ);
+        pageResult.push_back(Pair("utxos", result));
+        if (unspentOutputs.size() == page.limit) {
+            pageResult.push_back(Pair("cursor", encodeAddressCursor(unspentOutputs.back().first)));
+        }
+        return pageResult;
+    }
+
     return result;
 }
 
@@ -723,6 +849,9 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return a page of at most this many changes of a single address\n"
+            "  \"after\" (string, optional) The cursor of the previous page\n"
+            "  \"reverse\" (boolean, optional) Page from the most recent changes backwards\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -734,6 +863,11 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult with limit:\n"
+            "{\n"
+            "  \"deltas\"  (array) The changes as above\n"
+            "  \"cursor\"  (string) Pass as \"after\" to get the next page, missing on the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -762,14 +896,28 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    AddressPageParams page;
+    bool fPaged = getPageFromParams(params, addresses, page);
+
+    if (fPaged) {
+        CAddressIndexKey after;
+        if (!page.after.empty()) {
+            decodeAddressCursor(page.after, addresses[0], after);
+        }
+        if (!GetAddressIndexPage(addresses[0].first, addresses[0].second, start, end, page.after.empty() ? NULL : &after,
+                                 page.reverse, page.limit, addressIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -792,6 +940,15 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(delta);
     }
 
+    if (fPaged) {
+        UniValue pageResult(UniValue::VOBJ);
+        pageResult.push_back(Pair("deltas", result));
+        if (addressIndex.size() == page.limit) {
+            pageResult.push_back(Pair("cursor", encodeAddressCursor(addressIndex.back().first)));
+        }
+        return pageResult;
+    }
+
     return result;
 }
 
@@ -825,27 +982,14 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
-    CAmount balance = 0;
-    CAmount received = 0;
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
-        }
-        balance += it->second;
+    CAddressBalanceValue total;
+    if (!GetAddressBalances(addresses, total)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("balance", balance));
-    result.push_back(Pair("received", received));
+    result.push_back(Pair("balance", total.balance));
+    result.push_back(Pair("received", total.received));
 
     return result;
 
@@ -866,12 +1010,20 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return a page of the txids of at most this many changes of a single address\n"
+            "  \"after\" (string, optional) The cursor of the previous page\n"
+            "  \"reverse\" (boolean, optional) Page from the most recent txids backwards\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult with limit:\n"
+            "{\n"
+            "  \"txids\"  (array) The transaction ids as above, a txid may be repeated on the next page\n"
+            "  \"cursor\"  (string) Pass as \"after\" to get the next page, missing on the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -896,14 +1048,28 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    AddressPageParams page;
+    bool fPaged = getPageFromParams(params, addresses, page);
+
+    if (fPaged) {
+        CAddressIndexKey after;
+        if (!page.after.empty()) {
+            decodeAddressCursor(page.after, addresses[0], after);
+        }
+        if (!GetAddressIndexPage(addresses[0].first, addresses[0].second, start, end, page.after.empty() ? NULL : &after,
+                                 page.reverse, page.limit, addressIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -930,6 +1096,15 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    if (fPaged) {
+        UniValue pageResult(UniValue::VOBJ);
+        pageResult.push_back(Pair("txids", result));
+        if (addressIndex.size() == page.limit) {
+            pageResult.push_back(Pair("cursor", encodeAddressCursor(addressIndex.back().first)));
+        }
+        return pageResult;
+    }
+
     return result;
 
 }
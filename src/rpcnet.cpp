@@ -9,6 +9,7 @@
 #include "chainparams.h"
 #include "clientversion.h"
 #include "main.h"
+#include "messagestats.h"
 #include "net.h"
 #include "netbase.h"
 #include "protocol.h"
@@ -404,6 +405,67 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     return obj;
 }
 
+static UniValue TimeHistogramToJSON(const CTimeHistogram& hist)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("total_us", hist.nTotalMicros));
+    obj.push_back(Pair("max_us", hist.nMaxMicros));
+    UniValue buckets(UniValue::VARR);
+    for (int i = 0; i < CTimeHistogram::BUCKETS; i++)
+        buckets.push_back((int64_t)hist.vBuckets[i]);
+    obj.push_back(Pair("histogram", buckets));
+    return obj;
+}
+
+UniValue getmessagestats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getmessagestats ( reset )\n"
+            "\nReturns per command stats of the P2P messages processed since startup or the last reset.\n"
+            "Each histogram counts messages in buckets of below 10us, 100us, 1ms, 10ms, 100ms, 1s, 10s and longer.\n"
+            "Commands this node doesn't know are counted together as \"unknown\".\n"
+            "\nArguments:\n"
+            "1. reset     (boolean, optional, default=false) Clear the stats after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"command\": {             (string) P2P message command\n"
+            "    \"count\": n,            (numeric) Number of messages processed\n"
+            "    \"bytes\": n,            (numeric) Total payload size of these messages\n"
+            "    \"queue\": {             (json object) Time from receipt of the message to the start of its processing\n"
+            "      \"total_us\": n,       (numeric) Total time in microseconds\n"
+            "      \"max_us\": n,         (numeric) Longest time in microseconds\n"
+            "      \"histogram\": [n,...] (array) Number of messages in each bucket\n"
+            "    },\n"
+            "    \"process\": {...},      (json object) Time spent processing the message, same fields as above\n"
+            "    \"lockwait\": {...}      (json object) Time blocked on contended locks (mostly cs_main) while processing, same fields as above\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagestats", "")
+            + HelpExampleRpc("getmessagestats", "true")
+        );
+
+    std::map<std::string, CMessageStats> mapStats;
+    GetMessageStats(mapStats);
+    if (params.size() > 0 && params[0].get_bool())
+        ResetMessageStats();
+
+    UniValue obj(UniValue::VOBJ);
+    BOOST_FOREACH(const PAIRTYPE(std::string, CMessageStats)& pair, mapStats) {
+        const CMessageStats& stats = pair.second;
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("count", (int64_t)stats.nCount));
+        entry.push_back(Pair("bytes", (int64_t)stats.nBytes));
+        entry.push_back(Pair("queue", TimeHistogramToJSON(stats.histQueue)));
+        entry.push_back(Pair("process", TimeHistogramToJSON(stats.histProcess)));
+        entry.push_back(Pair("lockwait", TimeHistogramToJSON(stats.histLockWait)));
+        obj.push_back(Pair(pair.first, entry));
+    }
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -169,7 +169,7 @@ UniValue safenode(const UniValue& params, bool fHelp)
             return mnodeman.CountEnabled();
 
         int nCount;
-        mnodeman.GetNextSafenodeInQueueForPayment(true, nCount);
+        mnodeman.GetNextSafenodeInQueueForPayment(true, nCount, true);
 
         if (strMode == "qualify")
             return nCount;
@@ -270,6 +270,7 @@ static const CRPCCommand vRPCCommands[] =
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
     { "network",            "getconnectioncount",     &getconnectioncount,     true  },
     { "network",            "getnettotals",           &getnettotals,           true  },
+    { "network",            "getmessagestats",        &getmessagestats,        true  },
     { "network",            "getpeerinfo",            &getpeerinfo,            true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
@@ -353,6 +354,7 @@ static const CRPCCommand vRPCCommands[] =
     { "safenode",               "voteraw",                &voteraw,                true  },
     { "safenode",               "mnsync",                 &mnsync,                 true  },
     { "safenode",               "spork",                  &spork,                  true  },
+    { "safenode",               "getmsgsigcacheinfo",     &getmsgsigcacheinfo,     true  },
     { "safenode",               "getpoolinfo",            &getpoolinfo,            true  },
 #ifdef ENABLE_WALLET
     { "safenode",               "privatesend",            &privatesend,            false },
@@ -117,13 +117,14 @@ bool CSafenode::UpdateFromNewBroadcast(CSafenodeBroadcast& mnb)
     vchSig = mnb.vchSig;
     nProtocolVersion = mnb.nProtocolVersion;
     addr = mnb.addr;
+    mnodeman.InvalidateSafenodeRanks();
     nPoSeBanScore = 0;
     nPoSeBanHeight = 0;
     nTimeLastChecked = 0;
     int nDos = 0;
     if(mnb.lastPing == CSafenodePing() || (mnb.lastPing != CSafenodePing() && mnb.lastPing.CheckAndUpdate(this, true, nDos))) {
         lastPing = mnb.lastPing;
-        mnodeman.mapSeenSafenodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
+        mnodeman.mapSeenSafenodePing.Insert(lastPing.GetHash(), lastPing);
     }
     // if it matches our Safenode privkey...
     if(fSafeNode && pubKeySafenode == activeSafenode.pubKeySafenode) {
@@ -166,6 +167,18 @@ void CSafenode::Check(bool fForce)
 {
     LOCK(cs);
 
+    int nActiveStateOnEntry = nActiveState;
+    CheckState(fForce);
+    // the state decides which rank tables this safenode belongs to
+    if(nActiveState != nActiveStateOnEntry) {
+        mnodeman.InvalidateSafenodeRanks();
+    }
+}
+
+void CSafenode::CheckState(bool fForce)
+{
+    AssertLockHeld(cs);
+
     if(ShutdownRequested()) return;
 
     if(!fForce && (GetTime() - nTimeLastChecked < SAFENODE_CHECK_SECONDS)) return;
@@ -614,7 +627,7 @@ bool CSafenodeBroadcast::CheckOutpoint(int& nDos)
         if(!lockMain) {
             // not mnb fault, let it to be checked again later
             LogPrint("safenode", "CSafenodeBroadcast::CheckOutpoint -- Failed to aquire lock, addr=%s", addr.ToString());
-            mnodeman.mapSeenSafenodeBroadcast.erase(GetHash());
+            mnodeman.mapSeenSafenodeBroadcast.Erase(GetHash());
             return false;
         }
 
@@ -635,7 +648,7 @@ bool CSafenodeBroadcast::CheckOutpoint(int& nDos)
             LogPrintf("CSafenodeBroadcast::CheckOutpoint -- Safenode UTXO must have at least %d confirmations, safenode=%s\n",
                     Params().GetConsensus().nSafenodeMinimumConfirmations, vin.prevout.ToStringShort());
             // maybe we miss few blocks, let this mnb to be checked again later
-            mnodeman.mapSeenSafenodeBroadcast.erase(GetHash());
+            mnodeman.mapSeenSafenodeBroadcast.Erase(GetHash());
             return false;
         }
     }
@@ -860,8 +873,10 @@ bool CSafenodePing::CheckAndUpdate(CSafenode* pmn, bool fFromNewBroadcast, int&
     // and update mnodeman.mapSeenSafenodeBroadcast.lastPing which is probably outdated
     CSafenodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
-    if (mnodeman.mapSeenSafenodeBroadcast.count(hash)) {
-        mnodeman.mapSeenSafenodeBroadcast[hash].second.lastPing = *this;
+    std::pair<int64_t, CSafenodeBroadcast> mnbSeen;
+    if (mnodeman.mapSeenSafenodeBroadcast.Get(hash, mnbSeen)) {
+        mnbSeen.second.lastPing = *this;
+        mnodeman.mapSeenSafenodeBroadcast.Set(hash, mnbSeen);
     }
 
     pmn->Check(true); // force update, ignoring cache
@@ -17,12 +17,27 @@ CSafenodeMan mnodeman;
 
 const std::string CSafenodeMan::SERIALIZATION_VERSION_STRING = "CSafenodeMan-Version-4";
 
-struct CompareLastPaidBlock
+struct IsSeenPingExpired
 {
-    bool operator()(const std::pair<int, CSafenode*>& t1,
-                    const std::pair<int, CSafenode*>& t2) const
+    bool operator()(const uint256& hash, CSafenodePing& mnp) const
     {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+        if(!mnp.IsExpired()) return false;
+        LogPrint("safenode", "CSafenodeMan::CheckAndRemove -- Removing expired Safenode ping: hash=%s\n", hash.ToString());
+        return true;
+    }
+};
+
+struct IsSeenVerificationExpired
+{
+    int nMinBlockHeight;
+
+    IsSeenVerificationExpired(int nMinBlockHeightIn) : nMinBlockHeight(nMinBlockHeightIn) {}
+
+    bool operator()(const uint256& hash, const CSafenodeVerification& mnv) const
+    {
+        if(mnv.nBlockHeight >= nMinBlockHeight) return false;
+        LogPrint("safenode", "CSafenodeMan::CheckAndRemove -- Removing expired Safenode verification: hash=%s\n", hash.ToString());
+        return true;
     }
 };
 
@@ -35,6 +50,26 @@ struct CompareScoreMN
     }
 };
 
+CSafenodeLookupHasher::CSafenodeLookupHasher()
+    : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+      k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{}
+
+size_t CSafenodeLookupHasher::operator()(const COutPoint& outpoint) const
+{
+    return SipHashUint256Extra(k0, k1, outpoint.hash, outpoint.n);
+}
+
+size_t CSafenodeLookupHasher::operator()(const CPubKey& pubKey) const
+{
+    return CSipHasher(k0, k1).Write(pubKey.begin(), pubKey.size()).Finalize();
+}
+
+size_t CSafenodeLookupHasher::operator()(const CScript& script) const
+{
+    return CSipHasher(k0, k1).Write(script.empty() ? NULL : &script[0], script.size()).Finalize();
+}
+
 CSafenodeIndex::CSafenodeIndex()
     : nSize(0),
       mapIndex(),
@@ -98,7 +133,11 @@ void CSafenodeIndex::RebuildIndex()
 
 CSafenodeMan::CSafenodeMan()
 : cs(),
-  vSafenodes(),
+  listSafenodes(),
+  mapSafenodesByOutpoint(),
+  mapSafenodesByPubKey(),
+  mapSafenodesByPayee(),
+  setPaymentQueue(),
   mAskedUsForSafenodeList(),
   mWeAskedForSafenodeList(),
   mWeAskedForSafenodeListEntry(),
@@ -114,6 +153,9 @@ CSafenodeMan::CSafenodeMan()
   fSafenodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  nListVersion(0),
+  listRankTables(),
+  nRankTablesVersion(0),
   mapSeenSafenodeBroadcast(),
   mapSeenSafenodePing(),
   nDsqCount(0)
@@ -126,8 +168,10 @@ bool CSafenodeMan::Add(CSafenode &mn)
     CSafenode *pmn = Find(mn.vin);
     if (pmn == NULL) {
         LogPrint("safenode", "CSafenodeMan::Add -- Adding new Safenode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
-        vSafenodes.push_back(mn);
+        listSafenodes.push_back(mn);
+        AddToLookup(&listSafenodes.back());
         indexSafenodes.AddSafenodeVIN(mn.vin);
+        InvalidateSafenodeRanks();
         fSafenodesAdded = true;
         return true;
     }
@@ -170,7 +214,7 @@ void CSafenodeMan::Check()
 
     LogPrint("safenode", "CSafenodeMan::Check -- nLastWatchdogVoteTime=%d, IsWatchdogActive()=%d\n", nLastWatchdogVoteTime, IsWatchdogActive());
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
         mn.Check();
     }
 }
@@ -189,11 +233,11 @@ void CSafenodeMan::CheckAndRemove()
         Check();
 
         // Remove spent safenodes, prepare structures and make requests to reasure the state of inactive ones
-        std::vector<CSafenode>::iterator it = vSafenodes.begin();
+        std::list<CSafenode>::iterator it = listSafenodes.begin();
         std::vector<std::pair<int, CSafenode> > vecSafenodeRanks;
         // ask for up to MNB_RECOVERY_MAX_ASK_ENTRIES safenode entries at a time
         int nAskForMnbRecovery = MNB_RECOVERY_MAX_ASK_ENTRIES;
-        while(it != vSafenodes.end()) {
+        while(it != listSafenodes.end()) {
             CSafenodeBroadcast mnb = CSafenodeBroadcast(*it);
             uint256 hash = mnb.GetHash();
             // If collateral was spent ...
@@ -201,13 +245,15 @@ void CSafenodeMan::CheckAndRemove()
                 LogPrint("safenode", "CSafenodeMan::CheckAndRemove -- Removing Safenode: %s  addr=%s  %i now\n", (*it).GetStateString(), (*it).addr.ToString(), size() - 1);
 
                 // erase all of the broadcasts we've seen from this txin, ...
-                mapSeenSafenodeBroadcast.erase(hash);
+                mapSeenSafenodeBroadcast.Erase(hash);
                 mWeAskedForSafenodeListEntry.erase((*it).vin.prevout);
 
                 // and finally remove it from the list
                 it->FlagGovernanceItemsAsDirty();
-                it = vSafenodes.erase(it);
+                RemoveFromLookup(&(*it));
+                it = listSafenodes.erase(it);
                 fSafenodesRemoved = true;
+                InvalidateSafenodeRanks();
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -265,10 +311,13 @@ void CSafenodeMan::CheckAndRemove()
             }
         }
     }
+    int nCachedBlockHeight;
     {
         // no need for cm_main below
         LOCK(cs);
 
+        nCachedBlockHeight = pCurrentBlockIndex->nHeight;
+
         std::map<uint256, std::pair< int64_t, std::set<CNetAddr> > >::iterator itMnbRequest = mMnbRecoveryRequests.begin();
         while(itMnbRequest != mMnbRecoveryRequests.end()){
             // Allow this mnb to be re-verified again after MNB_RECOVERY_RETRY_SECONDS seconds
@@ -320,37 +369,13 @@ void CSafenodeMan::CheckAndRemove()
 
         std::map<CNetAddr, CSafenodeVerification>::iterator it3 = mWeAskedForVerification.begin();
         while(it3 != mWeAskedForVerification.end()){
-            if(it3->second.nBlockHeight < pCurrentBlockIndex->nHeight - MAX_POSE_BLOCKS) {
+            if(it3->second.nBlockHeight < nCachedBlockHeight - MAX_POSE_BLOCKS) {
                 mWeAskedForVerification.erase(it3++);
             } else {
                 ++it3;
             }
         }
 
-        // NOTE: do not expire mapSeenSafenodeBroadcast entries here, clean them on mnb updates!
-
-        // remove expired mapSeenSafenodePing
-        std::map<uint256, CSafenodePing>::iterator it4 = mapSeenSafenodePing.begin();
-        while(it4 != mapSeenSafenodePing.end()){
-            if((*it4).second.IsExpired()) {
-                LogPrint("safenode", "CSafenodeMan::CheckAndRemove -- Removing expired Safenode ping: hash=%s\n", (*it4).second.GetHash().ToString());
-                mapSeenSafenodePing.erase(it4++);
-            } else {
-                ++it4;
-            }
-        }
-
-        // remove expired mapSeenSafenodeVerification
-        std::map<uint256, CSafenodeVerification>::iterator itv2 = mapSeenSafenodeVerification.begin();
-        while(itv2 != mapSeenSafenodeVerification.end()){
-            if((*itv2).second.nBlockHeight < pCurrentBlockIndex->nHeight - MAX_POSE_BLOCKS){
-                LogPrint("safenode", "CSafenodeMan::CheckAndRemove -- Removing expired Safenode verification: hash=%s\n", (*itv2).first.ToString());
-                mapSeenSafenodeVerification.erase(itv2++);
-            } else {
-                ++itv2;
-            }
-        }
-
         LogPrintf("CSafenodeMan::CheckAndRemove -- %s\n", ToString());
 
         if(fSafenodesRemoved) {
@@ -358,6 +383,11 @@ void CSafenodeMan::CheckAndRemove()
         }
     }
 
+    // The seen maps have their own locks, expire them without blocking message processing on cs.
+    // NOTE: do not expire mapSeenSafenodeBroadcast entries here, clean them on mnb updates!
+    mapSeenSafenodePing.EraseIf(IsSeenPingExpired());
+    mapSeenSafenodeVerification.EraseIf(IsSeenVerificationExpired(nCachedBlockHeight - MAX_POSE_BLOCKS));
+
     if(fSafenodesRemoved) {
         NotifySafenodeUpdates();
     }
@@ -366,12 +396,14 @@ void CSafenodeMan::CheckAndRemove()
 void CSafenodeMan::Clear()
 {
     LOCK(cs);
-    vSafenodes.clear();
+    listSafenodes.clear();
+    RebuildLookup();
+    InvalidateSafenodeRanks();
     mAskedUsForSafenodeList.clear();
     mWeAskedForSafenodeList.clear();
     mWeAskedForSafenodeListEntry.clear();
-    mapSeenSafenodeBroadcast.clear();
-    mapSeenSafenodePing.clear();
+    mapSeenSafenodeBroadcast.Clear();
+    mapSeenSafenodePing.Clear();
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
     indexSafenodes.Clear();
@@ -384,7 +416,7 @@ int CSafenodeMan::CountSafenodes(int nProtocolVersion)
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinSafenodePaymentsProto() : nProtocolVersion;
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
         if(mn.nProtocolVersion < nProtocolVersion) continue;
         nCount++;
     }
@@ -398,7 +430,7 @@ int CSafenodeMan::CountEnabled(int nProtocolVersion)
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinSafenodePaymentsProto() : nProtocolVersion;
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
         if(mn.nProtocolVersion < nProtocolVersion || !mn.IsEnabled()) continue;
         nCount++;
     }
@@ -412,7 +444,7 @@ int CSafenodeMan::CountByIP(int nNetworkType)
     LOCK(cs);
     int nNodeCount = 0;
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes)
+    BOOST_FOREACH(CSafenode& mn, listSafenodes)
         if ((nNetworkType == NET_IPV4 && mn.addr.IsIPv4()) ||
             (nNetworkType == NET_TOR  && mn.addr.IsTor())  ||
             (nNetworkType == NET_IPV6 && mn.addr.IsIPv6())) {
@@ -444,40 +476,73 @@ void CSafenodeMan::DsegUpdate(CNode* pnode)
     LogPrint("safenode", "CSafenodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
-CSafenode* CSafenodeMan::Find(const CScript &payee)
+void CSafenodeMan::AddToLookup(CSafenode* pmn)
+{
+    AssertLockHeld(cs);
+
+    mapSafenodesByOutpoint[pmn->vin.prevout] = pmn;
+    mapSafenodesByPubKey.insert(std::make_pair(pmn->pubKeySafenode, pmn));
+    mapSafenodesByPayee.insert(std::make_pair(GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()), pmn));
+    setPaymentQueue.insert(std::make_pair(pmn->GetLastPaidBlock(), pmn));
+}
+
+template <typename Map>
+static void EraseLookupEntry(Map& map, const typename Map::key_type& key, const CSafenode* pmn)
+{
+    std::pair<typename Map::iterator, typename Map::iterator> range = map.equal_range(key);
+    for(typename Map::iterator it = range.first; it != range.second; ++it) {
+        if(it->second == pmn) {
+            map.erase(it);
+            return;
+        }
+    }
+}
+
+void CSafenodeMan::RemoveFromLookup(CSafenode* pmn)
+{
+    AssertLockHeld(cs);
+
+    EraseLookupEntry(mapSafenodesByOutpoint, pmn->vin.prevout, pmn);
+    EraseLookupEntry(mapSafenodesByPubKey, pmn->pubKeySafenode, pmn);
+    EraseLookupEntry(mapSafenodesByPayee, GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()), pmn);
+    setPaymentQueue.erase(std::make_pair(pmn->GetLastPaidBlock(), pmn));
+}
+
+void CSafenodeMan::RebuildLookup()
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes)
-    {
-        if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) == payee)
-            return &mn;
+    mapSafenodesByOutpoint.clear();
+    mapSafenodesByPubKey.clear();
+    mapSafenodesByPayee.clear();
+    setPaymentQueue.clear();
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
+        AddToLookup(&mn);
     }
-    return NULL;
+}
+
+CSafenode* CSafenodeMan::Find(const CScript &payee)
+{
+    LOCK(cs);
+
+    boost::unordered_multimap<CScript, CSafenode*, CSafenodeLookupHasher>::const_iterator it = mapSafenodesByPayee.find(payee);
+    return it == mapSafenodesByPayee.end() ? NULL : it->second;
 }
 
 CSafenode* CSafenodeMan::Find(const CTxIn &vin)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    boost::unordered_map<COutPoint, CSafenode*, CSafenodeLookupHasher>::const_iterator it = mapSafenodesByOutpoint.find(vin.prevout);
+    return it == mapSafenodesByOutpoint.end() ? NULL : it->second;
 }
 
 CSafenode* CSafenodeMan::Find(const CPubKey &pubKeySafenode)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes)
-    {
-        if(mn.pubKeySafenode == pubKeySafenode)
-            return &mn;
-    }
-    return NULL;
+    boost::unordered_multimap<CPubKey, CSafenode*, CSafenodeLookupHasher>::const_iterator it = mapSafenodesByPubKey.find(pubKeySafenode);
+    return it == mapSafenodesByPubKey.end() ? NULL : it->second;
 }
 
 bool CSafenodeMan::Get(const CPubKey& pubKeySafenode, CSafenode& safenode)
@@ -538,30 +603,39 @@ bool CSafenodeMan::Has(const CTxIn& vin)
 //
 // Deterministically select the oldest/best safenode to pay on the network
 //
-CSafenode* CSafenodeMan::GetNextSafenodeInQueueForPayment(bool fFilterSigTime, int& nCount)
+CSafenode* CSafenodeMan::GetNextSafenodeInQueueForPayment(bool fFilterSigTime, int& nCount, bool fCountAll)
 {
     if(!pCurrentBlockIndex) {
         nCount = 0;
         return NULL;
     }
-    return GetNextSafenodeInQueueForPayment(pCurrentBlockIndex->nHeight, fFilterSigTime, nCount);
+    return GetNextSafenodeInQueueForPayment(pCurrentBlockIndex->nHeight, fFilterSigTime, nCount, fCountAll);
 }
 
-CSafenode* CSafenodeMan::GetNextSafenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount)
+CSafenode* CSafenodeMan::GetNextSafenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, bool fCountAll)
 {
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
     CSafenode *pBestSafenode = NULL;
-    std::vector<std::pair<int, CSafenode*> > vecSafenodeLastPaid;
+    std::vector<CSafenode*> vecOldestSafenodes;
+
+    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
+    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
+    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
+    //  -- (chance per block * chances before IsScheduled will fire)
+    int nMnCount = CountEnabled();
+    int nTenthNetwork = std::max(nMnCount/10, 1);
 
     /*
-        Make a vector with all of the last paid times
+        Walk the queue from the least recently paid one, it is already sorted low to high
     */
 
-    int nMnCount = CountEnabled();
-    BOOST_FOREACH(CSafenode &mn, vSafenodes)
+    nCount = 0;
+    BOOST_FOREACH(const PAIRTYPE(int, CSafenode*)& s, setPaymentQueue)
     {
+        CSafenode &mn = *s.second;
+
         if(!mn.IsValidForPayment()) continue;
 
         // //check protocol version
@@ -576,37 +650,31 @@ CSafenode* CSafenodeMan::GetNextSafenodeInQueueForPayment(int nBlockHeight, bool
         //make sure it has at least as many confirmations as there are safenodes
         if(mn.GetCollateralAge() < nMnCount) continue;
 
-        vecSafenodeLastPaid.push_back(std::make_pair(mn.GetLastPaidBlock(), &mn));
-    }
+        nCount++;
+        if((int)vecOldestSafenodes.size() < nTenthNetwork) {
+            vecOldestSafenodes.push_back(&mn);
+        }
 
-    nCount = (int)vecSafenodeLastPaid.size();
+        // the rest of the queue can't change the winner anymore
+        if(!fCountAll && (int)vecOldestSafenodes.size() >= nTenthNetwork && (!fFilterSigTime || nCount >= nMnCount/3)) break;
+    }
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
-    if(fFilterSigTime && nCount < nMnCount/3) return GetNextSafenodeInQueueForPayment(nBlockHeight, false, nCount);
-
-    // Sort them low to high
-    sort(vecSafenodeLastPaid.begin(), vecSafenodeLastPaid.end(), CompareLastPaidBlock());
+    if(fFilterSigTime && nCount < nMnCount/3) return GetNextSafenodeInQueueForPayment(nBlockHeight, false, nCount, fCountAll);
 
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CSafenode::GetNextSafenodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
         return NULL;
     }
-    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
-    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
-    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
-    //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
+
     arith_uint256 nHighest = 0;
-    BOOST_FOREACH (PAIRTYPE(int, CSafenode*)& s, vecSafenodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+    BOOST_FOREACH (CSafenode* pmn, vecOldestSafenodes){
+        arith_uint256 nScore = pmn->CalculateScore(blockHash);
         if(nScore > nHighest){
             nHighest = nScore;
-            pBestSafenode = s.second;
+            pBestSafenode = pmn;
         }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
     }
     return pBestSafenode;
 }
@@ -625,7 +693,7 @@ CSafenode* CSafenodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToExclu
 
     // fill a vector of pointers
     std::vector<CSafenode*> vpSafenodesShuffled;
-    BOOST_FOREACH(CSafenode &mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode &mn, listSafenodes) {
         vpSafenodesShuffled.push_back(&mn);
     }
 
@@ -654,25 +722,34 @@ CSafenode* CSafenodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToExclu
     return NULL;
 }
 
-int CSafenodeMan::GetSafenodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+const CSafenodeMan::rank_table_t& CSafenodeMan::GetRankTable(const uint256& blockHash, int nMinProtocol, int nFilter)
 {
-    std::vector<std::pair<int64_t, CSafenode*> > vecSafenodeScores;
+    AssertLockHeld(cs);
 
-    //make sure we know about this block
-    uint256 blockHash = uint256();
-    if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
+    // any list or state change makes all tables stale at once
+    int64_t nVersion = nListVersion;
+    if(nVersion != nRankTablesVersion) {
+        listRankTables.clear();
+        nRankTablesVersion = nVersion;
+    }
 
-    LOCK(cs);
+    bool fRequireSentinel = nFilter == RANK_FILTER_VALID_FOR_PAYMENT && sporkManager.IsSporkActive(SPORK_14_REQUIRE_SENTINEL_FLAG);
 
-    // scan for winner
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive) {
-            if(!mn.IsEnabled()) continue;
-        }
-        else {
-            if(!mn.IsValidForPayment()) continue;
+    for(std::list<rank_table_t>::iterator it = listRankTables.begin(); it != listRankTables.end(); ++it) {
+        if(it->blockHash == blockHash && it->nMinProtocol == nMinProtocol &&
+           it->nFilter == nFilter && it->fRequireSentinel == fRequireSentinel) {
+            listRankTables.splice(listRankTables.begin(), listRankTables, it);
+            return listRankTables.front();
         }
+    }
+
+    std::vector<std::pair<int64_t, CSafenode*> > vecSafenodeScores;
+
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
+        if(mn.nProtocolVersion < nMinProtocol) continue;
+        if(nFilter == RANK_FILTER_ENABLED && !mn.IsEnabled()) continue;
+        if(nFilter == RANK_FILTER_VALID_FOR_PAYMENT && !mn.IsValidForPayment()) continue;
+
         int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
 
         vecSafenodeScores.push_back(std::make_pair(nScore, &mn));
@@ -680,42 +757,59 @@ int CSafenodeMan::GetSafenodeRank(const CTxIn& vin, int nBlockHeight, int nMinPr
 
     sort(vecSafenodeScores.rbegin(), vecSafenodeScores.rend(), CompareScoreMN());
 
+    listRankTables.push_front(rank_table_t());
+    rank_table_t& table = listRankTables.front();
+    table.blockHash = blockHash;
+    table.nMinProtocol = nMinProtocol;
+    table.nFilter = nFilter;
+    table.fRequireSentinel = fRequireSentinel;
+    table.vecRanked.reserve(vecSafenodeScores.size());
+
     int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CSafenode*)& scorePair, vecSafenodeScores) {
+    BOOST_FOREACH (PAIRTYPE(int64_t, CSafenode*)& s, vecSafenodeScores) {
         nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
+        table.vecRanked.push_back(s.second);
+        table.mapRanks[s.second->vin.prevout] = nRank;
+    }
+
+    if((int)listRankTables.size() > MAX_RANK_TABLES) {
+        listRankTables.pop_back();
     }
 
-    return -1;
+    return table;
 }
 
-std::vector<std::pair<int, CSafenode> > CSafenodeMan::GetSafenodeRanks(int nBlockHeight, int nMinProtocol)
+int CSafenodeMan::GetSafenodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CSafenode*> > vecSafenodeScores;
-    std::vector<std::pair<int, CSafenode> > vecSafenodeRanks;
-
     //make sure we know about this block
     uint256 blockHash = uint256();
-    if(!GetBlockHash(blockHash, nBlockHeight)) return vecSafenodeRanks;
+    if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    const rank_table_t& table = GetRankTable(blockHash, nMinProtocol, fOnlyActive ? RANK_FILTER_ENABLED : RANK_FILTER_VALID_FOR_PAYMENT);
 
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
+    std::map<COutPoint, int>::const_iterator it = table.mapRanks.find(vin.prevout);
+    if(it == table.mapRanks.end()) return -1;
 
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
+    return it->second;
+}
 
-        vecSafenodeScores.push_back(std::make_pair(nScore, &mn));
-    }
+std::vector<std::pair<int, CSafenode> > CSafenodeMan::GetSafenodeRanks(int nBlockHeight, int nMinProtocol)
+{
+    std::vector<std::pair<int, CSafenode> > vecSafenodeRanks;
 
-    sort(vecSafenodeScores.rbegin(), vecSafenodeScores.rend(), CompareScoreMN());
+    //make sure we know about this block
+    uint256 blockHash = uint256();
+    if(!GetBlockHash(blockHash, nBlockHeight)) return vecSafenodeRanks;
 
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CSafenode*)& s, vecSafenodeScores) {
-        nRank++;
-        vecSafenodeRanks.push_back(std::make_pair(nRank, *s.second));
+    LOCK(cs);
+
+    const rank_table_t& table = GetRankTable(blockHash, nMinProtocol, RANK_FILTER_ENABLED);
+
+    vecSafenodeRanks.reserve(table.vecRanked.size());
+    for(size_t i = 0; i < table.vecRanked.size(); i++) {
+        vecSafenodeRanks.push_back(std::make_pair(i + 1, *table.vecRanked[i]));
     }
 
     return vecSafenodeRanks;
@@ -723,8 +817,6 @@ std::vector<std::pair<int, CSafenode> > CSafenodeMan::GetSafenodeRanks(int nBloc
 
 CSafenode* CSafenodeMan::GetSafenodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CSafenode*> > vecSafenodeScores;
-
     LOCK(cs);
 
     uint256 blockHash;
@@ -733,28 +825,11 @@ CSafenode* CSafenodeMan::GetSafenodeByRank(int nRank, int nBlockHeight, int nMin
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    const rank_table_t& table = GetRankTable(blockHash, nMinProtocol, fOnlyActive ? RANK_FILTER_ENABLED : RANK_FILTER_NONE);
 
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
+    if(nRank < 1 || nRank > (int)table.vecRanked.size()) return NULL;
 
-        vecSafenodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecSafenodeScores.rbegin(), vecSafenodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CSafenode*)& s, vecSafenodeScores){
-        rank++;
-        if(rank == nRank) {
-            return s.second;
-        }
-    }
-
-    return NULL;
+    return table.vecRanked[nRank - 1];
 }
 
 void CSafenodeMan::ProcessSafenodeConnections()
@@ -837,12 +912,12 @@ void CSafenodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
 
         LogPrint("safenode", "MNPING -- Safenode ping, safenode=%s\n", mnp.vin.prevout.ToStringShort());
 
+        // drop pings we've seen already before touching cs_main or cs
+        if(!mapSeenSafenodePing.Insert(nHash, mnp)) return; //seen
+
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
-        if(mapSeenSafenodePing.count(nHash)) return; //seen
-        mapSeenSafenodePing.insert(std::make_pair(nHash, mnp));
-
         LogPrint("safenode", "MNPING -- Safenode ping, safenode=%s new\n", mnp.vin.prevout.ToStringShort());
 
         // see if we have this Safenode
@@ -900,7 +975,7 @@ void CSafenodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
 
         int nInvCount = 0;
 
-        BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+        BOOST_FOREACH(CSafenode& mn, listSafenodes) {
             if (vin != CTxIn() && vin != mn.vin) continue; // asked for specific vin but we are not there yet
             if (mn.addr.IsRFC1918() || mn.addr.IsLocal()) continue; // do not send local network safenode
             if (mn.IsUpdateRequired()) continue; // do not send outdated safenodes
@@ -912,9 +987,7 @@ void CSafenodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
             pfrom->PushInventory(CInv(MSG_SAFENODE_PING, mn.lastPing.GetHash()));
             nInvCount++;
 
-            if (!mapSeenSafenodeBroadcast.count(hash)) {
-                mapSeenSafenodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
-            }
+            mapSeenSafenodeBroadcast.Insert(hash, std::make_pair(GetTime(), mnb));
 
             if (vin == mn.vin) {
                 LogPrintf("DSEG -- Sent 1 Safenode inv to peer %d\n", pfrom->id);
@@ -995,7 +1068,7 @@ void CSafenodeMan::DoFullVerificationStep()
     if(nOffset >= (int)vecSafenodeRanks.size()) return;
 
     std::vector<CSafenode*> vSortedByAddr;
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
         vSortedByAddr.push_back(&mn);
     }
 
@@ -1035,7 +1108,7 @@ void CSafenodeMan::DoFullVerificationStep()
 
 void CSafenodeMan::CheckSameAddr()
 {
-    if(!safenodeSync.IsSynced() || vSafenodes.empty()) return;
+    if(!safenodeSync.IsSynced() || listSafenodes.empty()) return;
 
     std::vector<CSafenode*> vBan;
     std::vector<CSafenode*> vSortedByAddr;
@@ -1046,7 +1119,7 @@ void CSafenodeMan::CheckSameAddr()
         CSafenode* pprevSafenode = NULL;
         CSafenode* pverifiedSafenode = NULL;
 
-        BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+        BOOST_FOREACH(CSafenode& mn, listSafenodes) {
             vSortedByAddr.push_back(&mn);
         }
 
@@ -1196,9 +1269,9 @@ void CSafenodeMan::ProcessVerifyReply(CNode* pnode, CSafenodeVerification& mnv)
 
         CSafenode* prealSafenode = NULL;
         std::vector<CSafenode*> vpSafenodesToBan;
-        std::vector<CSafenode>::iterator it = vSafenodes.begin();
+        std::list<CSafenode>::iterator it = listSafenodes.begin();
         std::string strMessage1 = strprintf("%s%d%s", pnode->addr.ToString(false), mnv.nonce, blockHash.ToString());
-        while(it != vSafenodes.end()) {
+        while(it != listSafenodes.end()) {
             if((CAddress)it->addr == pnode->addr) {
                 if(darkSendSigner.VerifyMessage(it->pubKeySafenode, mnv.vchSig1, strMessage1, strError)) {
                     // found it!
@@ -1263,11 +1336,10 @@ void CSafenodeMan::ProcessVerifyBroadcast(CNode* pnode, const CSafenodeVerificat
 {
     std::string strError;
 
-    if(mapSeenSafenodeVerification.find(mnv.GetHash()) != mapSeenSafenodeVerification.end()) {
+    if(!mapSeenSafenodeVerification.Insert(mnv.GetHash(), mnv)) {
         // we already have one
         return;
     }
-    mapSeenSafenodeVerification[mnv.GetHash()] = mnv;
 
     // we don't care about history
     if(mnv.nBlockHeight < pCurrentBlockIndex->nHeight - MAX_POSE_BLOCKS) {
@@ -1350,7 +1422,7 @@ void CSafenodeMan::ProcessVerifyBroadcast(CNode* pnode, const CSafenodeVerificat
 
         // increase ban score for everyone else with the same addr
         int nCount = 0;
-        BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+        BOOST_FOREACH(CSafenode& mn, listSafenodes) {
             if(mn.addr != mnv.addr || mn.vin.prevout == mnv.vin1.prevout) continue;
             mn.IncreasePoSeBanScore();
             nCount++;
@@ -1366,7 +1438,7 @@ std::string CSafenodeMan::ToString() const
 {
     std::ostringstream info;
 
-    info << "Safenodes: " << (int)vSafenodes.size() <<
+    info << "Safenodes: " << (int)listSafenodes.size() <<
             ", peers who asked us for Safenode list: " << (int)mAskedUsForSafenodeList.size() <<
             ", peers we asked for Safenode list: " << (int)mWeAskedForSafenodeList.size() <<
             ", entries in Safenode list we asked for: " << (int)mWeAskedForSafenodeListEntry.size() <<
@@ -1379,8 +1451,8 @@ std::string CSafenodeMan::ToString() const
 void CSafenodeMan::UpdateSafenodeList(CSafenodeBroadcast mnb)
 {
     LOCK(cs);
-    mapSeenSafenodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
-    mapSeenSafenodeBroadcast.insert(std::make_pair(mnb.GetHash(), std::make_pair(GetTime(), mnb)));
+    mapSeenSafenodePing.Insert(mnb.lastPing.GetHash(), mnb.lastPing);
+    mapSeenSafenodeBroadcast.Insert(mnb.GetHash(), std::make_pair(GetTime(), mnb));
 
     LogPrintf("CSafenodeMan::UpdateSafenodeList -- safenode=%s  addr=%s\n", mnb.vin.prevout.ToStringShort(), mnb.addr.ToString());
 
@@ -1391,10 +1463,14 @@ void CSafenodeMan::UpdateSafenodeList(CSafenodeBroadcast mnb)
             safenodeSync.AddedSafenodeList();
         }
     } else {
-        CSafenodeBroadcast mnbOld = mapSeenSafenodeBroadcast[CSafenodeBroadcast(*pmn).GetHash()].second;
-        if(pmn->UpdateFromNewBroadcast(mnb)) {
+        uint256 hashOld = CSafenodeBroadcast(*pmn).GetHash();
+        // the broadcast may carry a new safenode key
+        RemoveFromLookup(pmn);
+        bool fUpdated = pmn->UpdateFromNewBroadcast(mnb);
+        AddToLookup(pmn);
+        if(fUpdated) {
             safenodeSync.AddedSafenodeList();
-            mapSeenSafenodeBroadcast.erase(mnbOld.GetHash());
+            mapSeenSafenodeBroadcast.Erase(hashOld);
         }
     }
 }
@@ -1408,12 +1484,14 @@ bool CSafenodeMan::CheckMnbAndUpdateSafenodeList(CNode* pfrom, CSafenodeBroadcas
     LogPrint("safenode", "CSafenodeMan::CheckMnbAndUpdateSafenodeList -- safenode=%s\n", mnb.vin.prevout.ToStringShort());
 
     uint256 hash = mnb.GetHash();
-    if(mapSeenSafenodeBroadcast.count(hash) && !mnb.fRecovery) { //seen
+    std::pair<int64_t, CSafenodeBroadcast> mnbSeen;
+    if(!mnb.fRecovery && mapSeenSafenodeBroadcast.Get(hash, mnbSeen)) { //seen
         LogPrint("safenode", "CSafenodeMan::CheckMnbAndUpdateSafenodeList -- safenode=%s seen\n", mnb.vin.prevout.ToStringShort());
         // less then 2 pings left before this MN goes into non-recoverable state, bump sync timeout
-        if(GetTime() - mapSeenSafenodeBroadcast[hash].first > SAFENODE_NEW_START_REQUIRED_SECONDS - SAFENODE_MIN_MNP_SECONDS * 2) {
+        if(GetTime() - mnbSeen.first > SAFENODE_NEW_START_REQUIRED_SECONDS - SAFENODE_MIN_MNP_SECONDS * 2) {
             LogPrint("safenode", "CSafenodeMan::CheckMnbAndUpdateSafenodeList -- safenode=%s seen update\n", mnb.vin.prevout.ToStringShort());
-            mapSeenSafenodeBroadcast[hash].first = GetTime();
+            mnbSeen.first = GetTime();
+            mapSeenSafenodeBroadcast.Set(hash, mnbSeen);
             safenodeSync.AddedSafenodeList();
         }
         // did we ask this node for it?
@@ -1424,7 +1502,7 @@ bool CSafenodeMan::CheckMnbAndUpdateSafenodeList(CNode* pfrom, CSafenodeBroadcas
                 // do not allow node to send same mnb multiple times in recovery mode
                 mMnbRecoveryRequests[hash].second.erase(pfrom->addr);
                 // does it have newer lastPing?
-                if(mnb.lastPing.sigTime > mapSeenSafenodeBroadcast[hash].second.lastPing.sigTime) {
+                if(mnb.lastPing.sigTime > mnbSeen.second.lastPing.sigTime) {
                     // simulate Check
                     CSafenode mnTemp = CSafenode(mnb);
                     mnTemp.Check();
@@ -1439,7 +1517,7 @@ bool CSafenodeMan::CheckMnbAndUpdateSafenodeList(CNode* pfrom, CSafenodeBroadcas
         }
         return true;
     }
-    mapSeenSafenodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
+    mapSeenSafenodeBroadcast.Insert(hash, std::make_pair(GetTime(), mnb));
 
     LogPrint("safenode", "CSafenodeMan::CheckMnbAndUpdateSafenodeList -- safenode=%s new\n", mnb.vin.prevout.ToStringShort());
 
@@ -1451,13 +1529,17 @@ bool CSafenodeMan::CheckMnbAndUpdateSafenodeList(CNode* pfrom, CSafenodeBroadcas
     // search Safenode list
     CSafenode* pmn = Find(mnb.vin);
     if(pmn) {
-        CSafenodeBroadcast mnbOld = mapSeenSafenodeBroadcast[CSafenodeBroadcast(*pmn).GetHash()].second;
-        if(!mnb.Update(pmn, nDos)) {
+        uint256 hashOld = CSafenodeBroadcast(*pmn).GetHash();
+        // the broadcast may carry a new safenode key
+        RemoveFromLookup(pmn);
+        bool fUpdated = mnb.Update(pmn, nDos);
+        AddToLookup(pmn);
+        if(!fUpdated) {
             LogPrint("safenode", "CSafenodeMan::CheckMnbAndUpdateSafenodeList -- Update() failed, safenode=%s\n", mnb.vin.prevout.ToStringShort());
             return false;
         }
-        if(hash != mnbOld.GetHash()) {
-            mapSeenSafenodeBroadcast.erase(mnbOld.GetHash());
+        if(hash != hashOld) {
+            mapSeenSafenodeBroadcast.Erase(hashOld);
         }
     } else {
         if(mnb.CheckOutpoint(nDos)) {
@@ -1503,8 +1585,14 @@ void CSafenodeMan::UpdateLastPaid()
     // LogPrint("mnpayments", "CSafenodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
     //                         pCurrentBlockIndex->nHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
+        int nBlockLastPaidPrev = mn.GetLastPaidBlock();
         mn.UpdateLastPaid(pCurrentBlockIndex, nMaxBlocksToScanBack);
+        if(mn.GetLastPaidBlock() != nBlockLastPaidPrev) {
+            // move it to its new place in the payment queue
+            setPaymentQueue.erase(std::make_pair(nBlockLastPaidPrev, &mn));
+            setPaymentQueue.insert(std::make_pair(mn.GetLastPaidBlock(), &mn));
+        }
     }
 
     // every time is like the first time if winners list is not synced
@@ -1523,14 +1611,14 @@ void CSafenodeMan::CheckAndRebuildSafenodeIndex()
         return;
     }
 
-    if(indexSafenodes.GetSize() <= int(vSafenodes.size())) {
+    if(indexSafenodes.GetSize() <= int(listSafenodes.size())) {
         return;
     }
 
     indexSafenodesOld = indexSafenodes;
     indexSafenodes.Clear();
-    for(size_t i = 0; i < vSafenodes.size(); ++i) {
-        indexSafenodes.AddSafenodeVIN(vSafenodes[i].vin);
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
+        indexSafenodes.AddSafenodeVIN(mn.vin);
     }
 
     fIndexRebuilt = true;
@@ -1570,7 +1658,7 @@ bool CSafenodeMan::AddGovernanceVote(const CTxIn& vin, uint256 nGovernanceObject
 void CSafenodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
-    BOOST_FOREACH(CSafenode& mn, vSafenodes) {
+    BOOST_FOREACH(CSafenode& mn, listSafenodes) {
         mn.RemoveGovernanceObject(nGovernanceObjectHash);
     }
 }
@@ -1633,12 +1721,14 @@ void CSafenodeMan::SetSafenodeLastPing(const CTxIn& vin, const CSafenodePing& mn
         return;
     }
     pMN->lastPing = mnp;
-    mapSeenSafenodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    mapSeenSafenodePing.Insert(mnp.GetHash(), mnp);
 
     CSafenodeBroadcast mnb(*pMN);
     uint256 hash = mnb.GetHash();
-    if(mapSeenSafenodeBroadcast.count(hash)) {
-        mapSeenSafenodeBroadcast[hash].second.lastPing = mnp;
+    std::pair<int64_t, CSafenodeBroadcast> mnbSeen;
+    if(mapSeenSafenodeBroadcast.Get(hash, mnbSeen)) {
+        mnbSeen.second.lastPing = mnp;
+        mapSeenSafenodeBroadcast.Set(hash, mnbSeen);
     }
 }
 
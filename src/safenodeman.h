@@ -7,8 +7,13 @@
 #define SAFENODEMAN_H
 
 #include "safenode.h"
+#include "shardedmap.h"
 #include "sync.h"
 
+#include <atomic>
+
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 
 class CSafenodeMan;
@@ -79,6 +84,32 @@ private:
 
 };
 
+struct CompareLastPaidBlock
+{
+    bool operator()(const std::pair<int, CSafenode*>& t1,
+                    const std::pair<int, CSafenode*>& t2) const
+    {
+        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+    }
+};
+
+/**
+ * Salted hasher for the lookup maps of CSafenodeMan, so that peers can't
+ * craft collateral outpoints or keys that all land in one bucket.
+ */
+class CSafenodeLookupHasher
+{
+private:
+    uint64_t k0, k1;
+
+public:
+    CSafenodeLookupHasher();
+
+    size_t operator()(const COutPoint& outpoint) const;
+    size_t operator()(const CPubKey& pubKey) const;
+    size_t operator()(const CScript& script) const;
+};
+
 class CSafenodeMan
 {
 public:
@@ -111,6 +142,31 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    /// Number of per-block rank tables kept around
+    static const int MAX_RANK_TABLES                = 16;
+
+    /// Which safenodes take part in a ranking
+    enum rank_filter_e {
+        RANK_FILTER_NONE,
+        RANK_FILTER_ENABLED,
+        RANK_FILTER_VALID_FOR_PAYMENT
+    };
+
+    /**
+     * Safenodes ordered by score for one block, best first.
+     *
+     * Pointers refer to elements of listSafenodes and stay valid as long as
+     * nRankTablesVersion matches nListVersion.
+     */
+    struct rank_table_t {
+        uint256 blockHash;
+        int nMinProtocol;
+        int nFilter;
+        // IsValidForPayment() depends on SPORK_14
+        bool fRequireSentinel;
+        std::vector<CSafenode*> vecRanked;
+        std::map<COutPoint, int> mapRanks;
+    };
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -118,8 +174,14 @@ private:
     // Keep track of current block index
     const CBlockIndex *pCurrentBlockIndex;
 
-    // map to hold all MNs
-    std::vector<CSafenode> vSafenodes;
+    // list to hold all MNs, a list so that pointers into it stay valid while others are added or removed
+    std::list<CSafenode> listSafenodes;
+    // lookup maps into listSafenodes, keys can be shared by several MNs except for the collateral outpoint
+    boost::unordered_map<COutPoint, CSafenode*, CSafenodeLookupHasher> mapSafenodesByOutpoint;
+    boost::unordered_multimap<CPubKey, CSafenode*, CSafenodeLookupHasher> mapSafenodesByPubKey;
+    boost::unordered_multimap<CScript, CSafenode*, CSafenodeLookupHasher> mapSafenodesByPayee;
+    // all MNs by last paid block, least recently paid first
+    std::set<std::pair<int, CSafenode*>, CompareLastPaidBlock> setPaymentQueue;
     // who's asked for the Safenode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForSafenodeList;
     // who we asked for the Safenode list and the last time
@@ -153,15 +215,31 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    /// Bumped whenever the list or a safenode state used for ranking changes
+    std::atomic<int64_t> nListVersion;
+
+    /// Most recently used rank tables first, all built at nRankTablesVersion
+    std::list<rank_table_t> listRankTables;
+    int64_t nRankTablesVersion;
+
     friend class CSafenodeSync;
 
+    /// Add/remove an entry of listSafenodes to/from the lookup maps and the payment queue, requires cs
+    void AddToLookup(CSafenode* pmn);
+    void RemoveFromLookup(CSafenode* pmn);
+    void RebuildLookup();
+
+    /// Get (building it if needed) the rank table for a block, requires cs
+    const rank_table_t& GetRankTable(const uint256& blockHash, int nMinProtocol, int nFilter);
+
 public:
-    // Keep track of all broadcasts I've seen
-    std::map<uint256, std::pair<int64_t, CSafenodeBroadcast> > mapSeenSafenodeBroadcast;
+    // Keep track of all broadcasts I've seen.
+    // The seen maps have their own locks and may be used without holding cs.
+    CShardedMap<uint256, std::pair<int64_t, CSafenodeBroadcast> > mapSeenSafenodeBroadcast;
     // Keep track of all pings I've seen
-    std::map<uint256, CSafenodePing> mapSeenSafenodePing;
+    CShardedMap<uint256, CSafenodePing> mapSeenSafenodePing;
     // Keep track of all verifications I've seen
-    std::map<uint256, CSafenodeVerification> mapSeenSafenodeVerification;
+    CShardedMap<uint256, CSafenodeVerification> mapSeenSafenodeVerification;
     // keep track of dsq count to prevent safenodes from gaming darksend queue
     int64_t nDsqCount;
 
@@ -180,7 +258,7 @@ public:
             READWRITE(strVersion);
         }
 
-        READWRITE(vSafenodes);
+        READWRITE(listSafenodes);
         READWRITE(mAskedUsForSafenodeList);
         READWRITE(mWeAskedForSafenodeList);
         READWRITE(mWeAskedForSafenodeListEntry);
@@ -192,6 +270,10 @@ public:
         READWRITE(mapSeenSafenodeBroadcast);
         READWRITE(mapSeenSafenodePing);
         READWRITE(indexSafenodes);
+        if(ser_action.ForRead()) {
+            RebuildLookup();
+            InvalidateSafenodeRanks();
+        }
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -285,15 +367,24 @@ public:
 
     safenode_info_t GetSafenodeInfo(const CPubKey& pubKeySafenode);
 
-    /// Find an entry in the safenode list that is next to be paid
-    CSafenode* GetNextSafenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount);
+    /// Find an entry in the safenode list that is next to be paid.
+    /// The queue is only walked as far as needed to pick the winner, so nCount is
+    /// the number of qualified safenodes seen unless fCountAll is set.
+    CSafenode* GetNextSafenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, bool fCountAll = false);
     /// Same as above but use current block height
-    CSafenode* GetNextSafenodeInQueueForPayment(bool fFilterSigTime, int& nCount);
+    CSafenode* GetNextSafenodeInQueueForPayment(bool fFilterSigTime, int& nCount, bool fCountAll = false);
 
     /// Find a random entry
     CSafenode* FindRandomNotInVec(const std::vector<CTxIn> &vecToExclude, int nProtocolVersion = -1);
 
-    std::vector<CSafenode> GetFullSafenodeVector() { return vSafenodes; }
+    /// Copy of the whole list, taken under cs so that callers can walk it without holding the lock
+    std::vector<CSafenode> GetFullSafenodeVector() {
+        LOCK(cs);
+        return std::vector<CSafenode>(listSafenodes.begin(), listSafenodes.end());
+    }
+
+    /// Drop cached rank tables, must be called on any change of the list or of a safenode state
+    void InvalidateSafenodeRanks() { nListVersion++; }
 
     std::vector<std::pair<int, CSafenode> > GetSafenodeRanks(int nBlockHeight = -1, int nMinProtocol=0);
     int GetSafenodeRank(const CTxIn &vin, int nBlockHeight, int nMinProtocol=0, bool fOnlyActive=true);
@@ -312,7 +403,7 @@ public:
     void ProcessVerifyBroadcast(CNode* pnode, const CSafenodeVerification& mnv);
 
     /// Return the number of (unique) Safenodes
-    int size() { return vSafenodes.size(); }
+    int size() { return listSafenodes.size(); }
 
     std::string ToString() const;
 
@@ -383,6 +383,52 @@ I ReadVarInt(Stream& is)
     }
 }
 
+/**
+ * Variable-length integers whose byte sequences sort like the numbers they
+ * encode, for use in database keys. The number of leading one bits of the
+ * first byte is the number of bytes that follow, the remaining bits hold the
+ * value big-endian, and the shortest possible form is always used:
+ *
+ * 0-127:         [0xxxxxxx]
+ * 128-16383:     [10xxxxxx xxxxxxxx]
+ * 16384-2097151: [110xxxxx xxxxxxxx xxxxxxxx]
+ * ...
+ * up to 2^64-1:  [0xFF 8 bytes]
+ */
+
+inline unsigned int GetSizeOfOrderedVarInt(uint64_t n)
+{
+    unsigned int nRet = 1;
+    while (nRet < 9 && (n >> (7 * nRet)) != 0)
+        nRet++;
+    return nRet;
+}
+
+template<typename Stream>
+void WriteOrderedVarInt(Stream& os, uint64_t n)
+{
+    unsigned int nExtra = GetSizeOfOrderedVarInt(n) - 1;
+    unsigned char chPrefix = ~(0xFF >> nExtra);
+    ser_writedata8(os, chPrefix | (nExtra < 8 ? (unsigned char)(n >> (8 * nExtra)) : 0));
+    while (nExtra--)
+        ser_writedata8(os, (unsigned char)(n >> (8 * nExtra)));
+}
+
+template<typename Stream>
+uint64_t ReadOrderedVarInt(Stream& is)
+{
+    unsigned char chData = ser_readdata8(is);
+    unsigned int nExtra = 0;
+    while (nExtra < 8 && (chData & (0x80 >> nExtra)))
+        nExtra++;
+    uint64_t n = nExtra < 8 ? (chData & (0x7F >> nExtra)) : 0;
+    for (unsigned int i = 0; i < nExtra; i++)
+        n = (n << 8) | ser_readdata8(is);
+    if (GetSizeOfOrderedVarInt(n) != nExtra + 1)
+        throw std::ios_base::failure("non-canonical ReadOrderedVarInt()");
+    return n;
+}
+
 #define FLATDATA(obj) REF(CFlatData((char*)&(obj), (char*)&(obj) + sizeof(obj)))
 #define VARINT(obj) REF(WrapVarInt(REF(obj)))
 #define LIMITED_STRING(obj,n) REF(LimitedString< n >(REF(obj)))
@@ -0,0 +1,188 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SHARDEDMAP_H_
+#define SHARDEDMAP_H_
+
+#include <map>
+#include <cstddef>
+
+#include "serialize.h"
+#include "sync.h"
+
+/**
+ * Picks a shard from the low bits of a uint256-like key
+ */
+struct CShardedMapCheapHasher
+{
+    template<typename K>
+    size_t operator()(const K& key) const
+    {
+        return key.GetCheapHash();
+    }
+};
+
+/**
+ * Map like container split into N shards, each guarded by its own lock.
+ *
+ * Every method locks only the shard that holds the key (or each shard in turn),
+ * so lookups from one thread don't wait on long updates of other keys made by
+ * another one. Read-modify-write sequences spanning several calls are not atomic,
+ * callers that need that must serialize them on their own.
+ *
+ * Serialized exactly like the std::map it replaces.
+ */
+template<typename K, typename V, size_t N = 16, typename Hasher = CShardedMapCheapHasher>
+class CShardedMap
+{
+public:
+    typedef std::map<K,V> map_t;
+
+    typedef typename map_t::iterator map_it;
+
+    typedef typename map_t::const_iterator map_cit;
+
+private:
+    struct shard_t {
+        mutable CCriticalSection cs;
+        map_t mapItems;
+    };
+
+    shard_t shards[N];
+
+    Hasher hasher;
+
+    shard_t& GetShard(const K& key)
+    {
+        return shards[hasher(key) % N];
+    }
+
+    const shard_t& GetShard(const K& key) const
+    {
+        return shards[hasher(key) % N];
+    }
+
+    // not copyable, shards hold locks
+    CShardedMap(const CShardedMap&);
+    CShardedMap& operator=(const CShardedMap&);
+
+public:
+    CShardedMap()
+        : hasher()
+    {}
+
+    void Clear()
+    {
+        for(size_t i = 0; i < N; ++i) {
+            LOCK(shards[i].cs);
+            shards[i].mapItems.clear();
+        }
+    }
+
+    size_t GetSize() const
+    {
+        size_t nSize = 0;
+        for(size_t i = 0; i < N; ++i) {
+            LOCK(shards[i].cs);
+            nSize += shards[i].mapItems.size();
+        }
+        return nSize;
+    }
+
+    bool HasKey(const K& key) const
+    {
+        const shard_t& shard = GetShard(key);
+        LOCK(shard.cs);
+        return shard.mapItems.count(key);
+    }
+
+    bool Get(const K& key, V& value) const
+    {
+        const shard_t& shard = GetShard(key);
+        LOCK(shard.cs);
+        map_cit it = shard.mapItems.find(key);
+        if(it == shard.mapItems.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    /// Add an item unless the key is already there, returns true if it was added
+    bool Insert(const K& key, const V& value)
+    {
+        shard_t& shard = GetShard(key);
+        LOCK(shard.cs);
+        return shard.mapItems.insert(std::make_pair(key, value)).second;
+    }
+
+    /// Add an item or overwrite the existing one
+    void Set(const K& key, const V& value)
+    {
+        shard_t& shard = GetShard(key);
+        LOCK(shard.cs);
+        shard.mapItems[key] = value;
+    }
+
+    bool Erase(const K& key)
+    {
+        shard_t& shard = GetShard(key);
+        LOCK(shard.cs);
+        return shard.mapItems.erase(key) > 0;
+    }
+
+    /// Remove all items for which pred(key, value) is true, one shard at a time
+    template<typename Predicate>
+    size_t EraseIf(Predicate pred)
+    {
+        size_t nErased = 0;
+        for(size_t i = 0; i < N; ++i) {
+            LOCK(shards[i].cs);
+            map_it it = shards[i].mapItems.begin();
+            while(it != shards[i].mapItems.end()) {
+                if(pred(it->first, it->second)) {
+                    shards[i].mapItems.erase(it++);
+                    ++nErased;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return nErased;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        map_t mapAll;
+        for(size_t i = 0; i < N; ++i) {
+            LOCK(shards[i].cs);
+            mapAll.insert(shards[i].mapItems.begin(), shards[i].mapItems.end());
+        }
+        ::Serialize(s, mapAll, nType, nVersion);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        map_t mapAll;
+        ::Unserialize(s, mapAll, nType, nVersion);
+        Clear();
+        for(map_cit it = mapAll.begin(); it != mapAll.end(); ++it) {
+            Insert(it->first, it->second);
+        }
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        map_t mapAll;
+        for(size_t i = 0; i < N; ++i) {
+            LOCK(shards[i].cs);
+            mapAll.insert(shards[i].mapItems.begin(), shards[i].mapItems.end());
+        }
+        return ::GetSerializeSize(mapAll, nType, nVersion);
+    }
+};
+
+#endif /* SHARDEDMAP_H_ */
@@ -13,12 +13,18 @@ struct CSpentIndexKey {
     uint256 txid;
     unsigned int outputIndex;
 
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
-        READWRITE(txid);
-        READWRITE(outputIndex);
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32 + GetSizeOfOrderedVarInt(outputIndex);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        txid.Serialize(s, nType, nVersion);
+        WriteOrderedVarInt(s, outputIndex);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        txid.Unserialize(s, nType, nVersion);
+        outputIndex = ReadOrderedVarInt(s);
     }
 
     CSpentIndexKey(uint256 t, unsigned int i) {
@@ -98,6 +98,8 @@ public:
 class CSporkManager
 {
 private:
+    // protects mapSporksActive, it is read from several message handler threads
+    mutable CCriticalSection cs;
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
     std::map<int, CSporkMessage> mapSporksActive;
@@ -19,6 +19,20 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+static boost::thread_specific_ptr<int64_t> lockwaittime;
+
+void AddThreadLockWaitTime(int64_t nMicros)
+{
+    if (lockwaittime.get() == NULL)
+        lockwaittime.reset(new int64_t(0));
+    *lockwaittime += nMicros;
+}
+
+int64_t GetThreadLockWaitTime()
+{
+    return lockwaittime.get() == NULL ? 0 : *lockwaittime;
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -0,0 +1,342 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "spentindex.h"
+#include "txdb.h"
+#include "uint256.h"
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, TestingSetup)
+
+static uint160 GetAddressHash(unsigned char n)
+{
+    uint160 addressHash;
+    addressHash.begin()[0] = n;
+    return addressHash;
+}
+
+static std::vector<std::pair<CAddressIndexKey, CAmount> > GetBlockRows(const uint160& addressHash, int nHeight)
+{
+    uint256 txhash1 = uint256S("01");
+    uint256 txhash2 = uint256S("02");
+    txhash1.begin()[31] = nHeight;
+    txhash2.begin()[31] = nHeight;
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vect;
+    // two outputs of one tx and a spend in another
+    vect.push_back(std::make_pair(CAddressIndexKey(1, addressHash, nHeight, 1, txhash1, 0, false), 5 * COIN));
+    vect.push_back(std::make_pair(CAddressIndexKey(1, addressHash, nHeight, 1, txhash1, 1, false), 3 * COIN));
+    vect.push_back(std::make_pair(CAddressIndexKey(1, addressHash, nHeight, 2, txhash2, 0, true), -2 * COIN));
+    return vect;
+}
+
+//! Key bytes of the fixed width layout of index version 0, with the prefix
+static std::vector<unsigned char> GetAddressIndexKeyV0(const CAddressIndexKey& key)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << 'a' << (unsigned char)key.type << key.hashBytes;
+    ser_writedata32be(ss, key.blockHeight);
+    ser_writedata32be(ss, key.txindex);
+    ss << key.txhash;
+    ser_writedata32(ss, key.index);
+    ss << (char)key.spending;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_connect_disconnect)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+    uint160 otherHash = GetAddressHash(2);
+    CAddressBalanceValue balance;
+
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 0);
+    BOOST_CHECK_EQUAL(balance.txcount, 0);
+
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 11)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 12 * COIN);
+    BOOST_CHECK_EQUAL(balance.received, 16 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 4);
+
+    // other types and addresses are kept apart
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 2, balance));
+    BOOST_CHECK_EQUAL(balance.txcount, 0);
+    BOOST_CHECK(db.ReadAddressBalance(otherHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.txcount, 0);
+
+    BOOST_CHECK(db.EraseAddressIndex(GetBlockRows(addressHash, 11)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 6 * COIN);
+    BOOST_CHECK_EQUAL(balance.received, 8 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 2);
+
+    BOOST_CHECK(db.EraseAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 0);
+    BOOST_CHECK_EQUAL(balance.txcount, 0);
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_reconnect)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+    CAddressBalanceValue balance;
+
+    // writing a block again, as when it's connected again after a crash, changes nothing
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 6 * COIN);
+    BOOST_CHECK_EQUAL(balance.received, 8 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 2);
+
+    // and neither does erasing it twice
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 11)));
+    BOOST_CHECK(db.EraseAddressIndex(GetBlockRows(addressHash, 11)));
+    BOOST_CHECK(db.EraseAddressIndex(GetBlockRows(addressHash, 11)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 6 * COIN);
+    BOOST_CHECK_EQUAL(balance.received, 8 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 2);
+
+    // disconnected and connected again, as by -checklevel=4
+    BOOST_CHECK(db.EraseAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, 10)));
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 6 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 2);
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_build)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+    uint160 otherHash = GetAddressHash(2);
+
+    // rows written without balances, as by nodes that didn't keep them
+    for (int nHeight = 10; nHeight < 13; nHeight++) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vect = GetBlockRows(addressHash, nHeight);
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vectOther = GetBlockRows(otherHash, nHeight);
+        vect.insert(vect.end(), vectOther.begin(), vectOther.end());
+        for (size_t i = 0; i < vect.size(); i++)
+            BOOST_CHECK(db.Write(std::make_pair('d', vect[i].first), vect[i].second));
+    }
+
+    BOOST_CHECK(db.BuildAddressBalanceIndex());
+
+    CAddressBalanceValue balance;
+    BOOST_CHECK(db.ReadAddressBalance(addressHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 18 * COIN);
+    BOOST_CHECK_EQUAL(balance.received, 24 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 6);
+    BOOST_CHECK(db.ReadAddressBalance(otherHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 18 * COIN);
+    BOOST_CHECK_EQUAL(balance.txcount, 6);
+}
+
+BOOST_AUTO_TEST_CASE(address_index_pages)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+    uint160 otherHash = GetAddressHash(2);
+
+    // 3 rows per block at heights 10 to 13, and another address next to it
+    for (int nHeight = 10; nHeight < 14; nHeight++) {
+        BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, nHeight)));
+        BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(otherHash, nHeight)));
+    }
+    std::vector<std::pair<CAddressIndexKey, CAmount> > all;
+    BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, all));
+    BOOST_CHECK_EQUAL(all.size(), 12U);
+
+    for (int nReverse = 0; nReverse < 2; nReverse++) {
+        bool fReverse = nReverse;
+        std::vector<std::pair<CAddressIndexKey, CAmount> > paged;
+        std::vector<std::pair<CAddressIndexKey, CAmount> > page;
+        do {
+            CAddressIndexKey after;
+            bool fAfter = !page.empty();
+            if (fAfter)
+                after = page.back().first;
+            page.clear();
+            BOOST_CHECK(db.ReadAddressIndexPage(addressHash, 1, 0, 0, fAfter ? &after : NULL, fReverse, 5, page));
+            paged.insert(paged.end(), page.begin(), page.end());
+        } while (page.size() == 5);
+        BOOST_CHECK_EQUAL(paged.size(), 12U);
+        for (size_t i = 0; i < paged.size(); i++) {
+            size_t j = fReverse ? all.size() - 1 - i : i;
+            BOOST_CHECK(paged[i].first.txhash == all[j].first.txhash);
+            BOOST_CHECK_EQUAL(paged[i].first.index, all[j].first.index);
+            BOOST_CHECK_EQUAL(paged[i].first.spending, all[j].first.spending);
+        }
+    }
+
+    // height range, both ways
+    std::vector<std::pair<CAddressIndexKey, CAmount> > page;
+    BOOST_CHECK(db.ReadAddressIndexPage(addressHash, 1, 11, 12, NULL, false, 100, page));
+    BOOST_CHECK_EQUAL(page.size(), 6U);
+    BOOST_CHECK_EQUAL(page.front().first.blockHeight, 11);
+    BOOST_CHECK_EQUAL(page.back().first.blockHeight, 12);
+    page.clear();
+    BOOST_CHECK(db.ReadAddressIndexPage(addressHash, 1, 11, 12, NULL, true, 100, page));
+    BOOST_CHECK_EQUAL(page.size(), 6U);
+    BOOST_CHECK_EQUAL(page.front().first.blockHeight, 12);
+    BOOST_CHECK_EQUAL(page.back().first.blockHeight, 11);
+
+    // the last address in the database pages backwards from its end too
+    page.clear();
+    BOOST_CHECK(db.ReadAddressIndexPage(otherHash, 1, 0, 0, NULL, true, 2, page));
+    BOOST_CHECK_EQUAL(page.size(), 2U);
+    BOOST_CHECK_EQUAL(page.front().first.blockHeight, 13);
+    BOOST_CHECK(page.front().first.hashBytes == otherHash);
+}
+
+BOOST_AUTO_TEST_CASE(address_unspent_pages)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+    uint160 otherHash = GetAddressHash(2);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vect;
+    for (int i = 0; i < 7; i++) {
+        uint256 txhash;
+        txhash.begin()[0] = i;
+        vect.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, txhash, 0), CAddressUnspentValue(COIN, CScript(), 10 + i)));
+        vect.push_back(std::make_pair(CAddressUnspentKey(1, otherHash, txhash, 0), CAddressUnspentValue(COIN, CScript(), 10 + i)));
+    }
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vect));
+
+    for (int nReverse = 0; nReverse < 2; nReverse++) {
+        bool fReverse = nReverse;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > paged;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > page;
+        do {
+            CAddressUnspentKey after;
+            bool fAfter = !page.empty();
+            if (fAfter)
+                after = page.back().first;
+            page.clear();
+            BOOST_CHECK(db.ReadAddressUnspentIndexPage(addressHash, 1, fAfter ? &after : NULL, fReverse, 3, page));
+            paged.insert(paged.end(), page.begin(), page.end());
+        } while (page.size() == 3);
+        BOOST_CHECK_EQUAL(paged.size(), 7U);
+        for (size_t i = 0; i < paged.size(); i++) {
+            BOOST_CHECK(paged[i].first.hashBytes == addressHash);
+            BOOST_CHECK_EQUAL(paged[i].second.blockHeight, fReverse ? 16 - (int)i : 10 + (int)i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(address_batch_reads)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    // many addresses, read back in key order with one cursor
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vect;
+    std::vector<std::pair<uint160, int> > addresses;
+    for (int n = 200; n > 0; n--) {
+        uint160 addressHash = GetAddressHash(n);
+        for (int i = 0; i < n % 3; i++) {
+            uint256 txhash;
+            txhash.begin()[0] = i;
+            vect.push_back(std::make_pair(CAddressUnspentKey(1, addressHash, txhash, 0), CAddressUnspentValue(n, CScript(), 10)));
+        }
+        if (n % 2)
+            addresses.push_back(std::make_pair(addressHash, 1));
+        BOOST_CHECK(db.WriteAddressIndex(GetBlockRows(addressHash, n)));
+    }
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vect));
+    // duplicates are only read once
+    addresses.push_back(addresses.front());
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > batch;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(addresses, batch));
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > single;
+    for (int n = 1; n <= 200; n += 2)
+        BOOST_CHECK(db.ReadAddressUnspentIndex(GetAddressHash(n), 1, single));
+    BOOST_CHECK_EQUAL(batch.size(), single.size());
+    for (size_t i = 0; i < batch.size() && i < single.size(); i++) {
+        BOOST_CHECK(batch[i].first.hashBytes == single[i].first.hashBytes);
+        BOOST_CHECK(batch[i].first.txhash == single[i].first.txhash);
+        BOOST_CHECK_EQUAL(batch[i].second.satoshis, single[i].second.satoshis);
+    }
+
+    CAddressBalanceValue total;
+    BOOST_CHECK(db.ReadAddressBalances(addresses, total));
+    BOOST_CHECK_EQUAL(total.balance, 100 * 6 * COIN);
+    BOOST_CHECK_EQUAL(total.received, 100 * 8 * COIN);
+    BOOST_CHECK_EQUAL(total.txcount, 100 * 2);
+}
+
+BOOST_AUTO_TEST_CASE(index_upgrade)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 addressHash = GetAddressHash(1);
+
+    // rows written by nodes using the fixed width keys
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vect = GetBlockRows(addressHash, 300);
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vectHigher = GetBlockRows(addressHash, 70000);
+    vect.insert(vect.end(), vectHigher.begin(), vectHigher.end());
+    std::vector<std::vector<unsigned char> > vKeysV0;
+    for (size_t i = 0; i < vect.size(); i++) {
+        vKeysV0.push_back(GetAddressIndexKeyV0(vect[i].first));
+        BOOST_CHECK(db.Write(CFlatData(vKeysV0.back()), vect[i].second));
+    }
+
+    uint256 txhash = uint256S("03");
+    CDataStream ssUnspent(SER_DISK, 0);
+    ssUnspent << 'u' << (unsigned char)1 << addressHash << txhash;
+    ser_writedata32(ssUnspent, 1);
+    std::vector<unsigned char> vUnspentKey(ssUnspent.begin(), ssUnspent.end());
+    BOOST_CHECK(db.Write(CFlatData(vUnspentKey), CAddressUnspentValue(COIN, CScript(), 300)));
+
+    CDataStream ssSpent(SER_DISK, 0);
+    ssSpent << 'p' << txhash;
+    ser_writedata32(ssSpent, 1);
+    std::vector<unsigned char> vSpentKey(ssSpent.begin(), ssSpent.end());
+    BOOST_CHECK(db.Write(CFlatData(vSpentKey), CSpentIndexValue(uint256S("04"), 0, 301, COIN, 1, addressHash)));
+
+    BOOST_CHECK_EQUAL(db.ReadIndexVersion(), 0);
+    BOOST_CHECK(db.UpgradeIndexes());
+    BOOST_CHECK_EQUAL(db.ReadIndexVersion(), INDEX_VERSION);
+
+    // the rows moved, in the same order
+    std::vector<std::pair<CAddressIndexKey, CAmount> > rows;
+    BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, rows));
+    BOOST_CHECK_EQUAL(rows.size(), vect.size());
+    for (size_t i = 0; i < rows.size() && i < vect.size(); i++) {
+        BOOST_CHECK_EQUAL(rows[i].first.blockHeight, vect[i].first.blockHeight);
+        BOOST_CHECK_EQUAL(rows[i].first.txindex, vect[i].first.txindex);
+        BOOST_CHECK(rows[i].first.txhash == vect[i].first.txhash);
+        BOOST_CHECK_EQUAL(rows[i].first.index, vect[i].first.index);
+        BOOST_CHECK_EQUAL(rows[i].first.spending, vect[i].first.spending);
+        BOOST_CHECK_EQUAL(rows[i].second, vect[i].second);
+        BOOST_CHECK(!db.Exists(CFlatData(vKeysV0[i])));
+        BOOST_CHECK(::GetSerializeSize(rows[i].first, SER_DISK, 0) < vKeysV0[i].size() - 1);
+    }
+    rows.clear();
+    BOOST_CHECK(db.ReadAddressIndex(addressHash, 1, rows, 301, 80000));
+    BOOST_CHECK_EQUAL(rows.size(), 3U);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(addressHash, 1, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), 1U);
+    BOOST_CHECK_EQUAL(unspent[0].first.index, 1U);
+    BOOST_CHECK(!db.Exists(CFlatData(vUnspentKey)));
+
+    CSpentIndexKey spentKey(txhash, 1);
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(db.ReadSpentIndex(spentKey, spentValue));
+    BOOST_CHECK_EQUAL(spentValue.blockHeight, 301);
+    BOOST_CHECK(!db.Exists(CFlatData(vSpentKey)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,12 +2,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/safenode-config.h"
+#endif
+
 #include "crypto/ripemd160.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/neoscrypt.h"
+#include "crypto/x16r.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_safenode.h"
@@ -248,4 +255,118 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(neoscrypt_testvectors) {
+    // Profile 0 as used for block headers. The results come from the plain C
+    // code; builds with the assembly routines (-DASM) must match them, on both
+    // the single and the 4-way batch path. Five inputs leave a batch tail.
+    static const char* outputs[] = {
+        "4967121d009c05807811a33690da50a93722dedb440f58c1d600933ede9133c6",
+        "3bdb3239bd4b67fce242989e553c7d96755f8fa3768b2c39409f0feaccce1bda",
+        "0d839a4c3f161300f969be8345f1d57caa7291201a21ea593a122c54cbacb366",
+        "87846e2c77a98c320e8bc20eac0e962df489de7fbca82668ba08e69af4339c03",
+        "ed51219e0b63a2968e661d973d54aea261699dc913ba2e1d0b860893ef17233a",
+    };
+    const unsigned int nCount = sizeof(outputs) / sizeof(outputs[0]);
+    std::vector<unsigned char> input(nCount * 80);
+    for (size_t i = 0; i < input.size(); i++)
+        input[i] = i * 7 + 3;
+
+    std::vector<unsigned char> batch(nCount * 32);
+    neoscrypt_batch(&input[0], &batch[0], nCount);
+    for (unsigned int i = 0; i < nCount; i++) {
+        unsigned char output[32];
+        neoscrypt(&input[i * 80], output, 0);
+        BOOST_CHECK_EQUAL(HexStr(output, output + 32), outputs[i]);
+        BOOST_CHECK_EQUAL(HexStr(&batch[i * 32], &batch[i * 32] + 32), outputs[i]);
+    }
+}
+
+#ifdef USE_NEOSCRYPT_ASM
+BOOST_AUTO_TEST_CASE(neoscrypt_asm_random) {
+    // The assembly routines against the C code on random headers, nine of
+    // them for two 4-way batches and a tail.
+    const unsigned int nCount = 9;
+    std::vector<unsigned char> input(nCount * 80);
+    GetRandBytes(&input[0], input.size());
+
+    std::vector<unsigned char> batch(nCount * 32);
+    neoscrypt_batch(&input[0], &batch[0], nCount);
+    for (unsigned int i = 0; i < nCount; i++) {
+        unsigned char output[32], expected[32];
+        neoscrypt(&input[i * 80], output, 0);
+        neoscrypt_ref(&input[i * 80], expected, 0);
+        BOOST_CHECK_EQUAL(HexStr(output, output + 32), HexStr(expected, expected + 32));
+        BOOST_CHECK_EQUAL(HexStr(&batch[i * 32], &batch[i * 32] + 32), HexStr(expected, expected + 32));
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(x16r_testvectors) {
+    // Mainnet genesis block header
+    const std::vector<unsigned char> header = ParseHex(
+        "010000000000000000000000000000000000000000000000000000000000000000000000597508aa0c67ec70"
+        "3ff8bb5eb0e429e02b1a0dd3b961d6d7b1dc9f0e669db6c810e4f15af0ff0f1eb63f0200");
+    // The genesis block has a null parent, so it runs blake512 sixteen times.
+    // The other parents select every algorithm once, in both directions; their
+    // results come from the sph reference code in the original HashX16R.
+    static const char* vectors[][2] = {
+        {"0000000000000000000000000000000000000000000000000000000000000000", "000006e4afebbabbf59acf1754d09461671aad36e373c3d360dbe083e244e129"},
+        {"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef", "004a3f60631ef138a59b6cf6a7a607cd90b96fc54f586c0657022939ee8e7a30"},
+        {"fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210", "58710e7098e74f58361f84643acf5b97460e0c947b66f88e08cdcab3f77b4110"},
+    };
+    const unsigned char* pdata[2] = {&header[0], &header[0]};
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const uint256 hashPrevBlock = uint256S(vectors[i][0]);
+        BOOST_CHECK_EQUAL(HashX16R(header.begin(), header.end(), hashPrevBlock).GetHex(), vectors[i][1]);
+
+        uint256 hashes[2];
+        CX16RPlan(hashPrevBlock).HashBatch(pdata, header.size(), 2, hashes);
+        BOOST_CHECK_EQUAL(hashes[0].GetHex(), vectors[i][1]);
+        BOOST_CHECK_EQUAL(hashes[1].GetHex(), vectors[i][1]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x16r_dispatch_matches_reference) {
+    // The test setup ran X16RAutoDetect, so optimized kernels are exercised
+    // where the CPU supports them. Cover short messages, every length around
+    // the block and padding boundaries, and multi-block messages.
+    std::vector<unsigned char> data(400);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = insecure_rand();
+    for (int algo = 0; algo < X16R_HASH_COUNT; algo++) {
+        for (size_t len = 0; len <= data.size(); len += (len < 260 ? 1 : 23)) {
+            unsigned char out[X16R_OUTPUT_SIZE], ref[X16R_OUTPUT_SIZE];
+            X16RHashAlgo(algo, data.data(), len, out);
+            X16RHashAlgoReference(algo, data.data(), len, ref);
+            BOOST_CHECK_MESSAGE(memcmp(out, ref, sizeof(out)) == 0, "algo " << algo << " len " << len);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x16r_batch) {
+    int order[X16R_HASH_COUNT];
+    for (int i = 0; i < X16R_HASH_COUNT; i++)
+        order[i] = insecure_rand() % X16R_HASH_COUNT;
+
+    const size_t n = 7, len = 80;
+    std::vector<unsigned char> data(n * len);
+    std::vector<const unsigned char*> pdata(n);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = insecure_rand();
+    for (size_t j = 0; j < n; j++)
+        pdata[j] = &data[j * len];
+
+    unsigned char out[n][X16R_OUTPUT_SIZE];
+    X16RHashBatch(order, pdata.data(), len, n, out);
+    for (size_t j = 0; j < n; j++) {
+        unsigned char ref[X16R_OUTPUT_SIZE], tmp[X16R_OUTPUT_SIZE];
+        X16RHashAlgoReference(order[0], pdata[j], len, ref);
+        for (int i = 1; i < X16R_HASH_COUNT; i++) {
+            memcpy(tmp, ref, sizeof(tmp));
+            X16RHashAlgoReference(order[i], tmp, sizeof(tmp), ref);
+        }
+        BOOST_CHECK(memcmp(out[j], ref, sizeof(ref)) == 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
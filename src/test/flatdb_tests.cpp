@@ -0,0 +1,152 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "serialize.h"
+#include "test/test_safenode.h"
+#include "tinyformat.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct CFlatDBTestData
+{
+    std::vector<int> vecItems;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(vecItems);
+    }
+
+    void Clear() { vecItems.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("Items: %d", (int)vecItems.size()); }
+};
+
+// Same data with a field added, as after a format change
+struct CFlatDBTestDataV2 : public CFlatDBTestData
+{
+    int64_t nExtra;
+
+    CFlatDBTestDataV2() : nExtra(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(vecItems);
+        READWRITE(nExtra);
+    }
+};
+
+static const std::string FLATDB_TEST_FILE = "flatdbtest.dat";
+static const std::string FLATDB_TEST_MAGIC = "FlatDBTest";
+
+static CFlatDBTestData CreateData(int nItems)
+{
+    CFlatDBTestData data;
+    for (int i = 0; i < nItems; i++)
+        data.vecItems.push_back(i * 7);
+    return data;
+}
+
+static boost::filesystem::path TestFilePath()
+{
+    return GetDataDir() / FLATDB_TEST_FILE;
+}
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatdb_roundtrip)
+{
+    CFlatDB<CFlatDBTestData> flatdb(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestData data = CreateData(1000);
+    BOOST_CHECK(flatdb.Dump(data));
+
+    CFlatDBTestData dataLoaded;
+    BOOST_CHECK(flatdb.Load(dataLoaded));
+    BOOST_CHECK(dataLoaded.vecItems == data.vecItems);
+
+    // dumping over an existing file of ours works too
+    data.vecItems.push_back(-1);
+    BOOST_CHECK(flatdb.Dump(data));
+    BOOST_CHECK(flatdb.Load(dataLoaded));
+    BOOST_CHECK(dataLoaded.vecItems == data.vecItems);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_missing)
+{
+    // a missing file is recreated on the next dump
+    boost::filesystem::remove(TestFilePath());
+    CFlatDB<CFlatDBTestData> flatdb(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestData dataLoaded = CreateData(10);
+    BOOST_CHECK(flatdb.Load(dataLoaded));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_truncated)
+{
+    CFlatDB<CFlatDBTestData> flatdb(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestData data = CreateData(1000);
+    BOOST_CHECK(flatdb.Dump(data));
+
+    uint64_t nFileSize = boost::filesystem::file_size(TestFilePath());
+    boost::filesystem::resize_file(TestFilePath(), nFileSize - 10);
+    CFlatDBTestData dataLoaded;
+    BOOST_CHECK(!flatdb.Load(dataLoaded));
+
+    boost::filesystem::resize_file(TestFilePath(), 10);
+    BOOST_CHECK(!flatdb.Load(dataLoaded));
+
+    boost::filesystem::resize_file(TestFilePath(), 0);
+    BOOST_CHECK(!flatdb.Load(dataLoaded));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_bitflip)
+{
+    CFlatDB<CFlatDBTestData> flatdb(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestData data = CreateData(1000);
+    BOOST_CHECK(flatdb.Dump(data));
+    uint64_t nFileSize = boost::filesystem::file_size(TestFilePath());
+
+    // in the magic message, in the vector size, in the items and in the checksum
+    const uint64_t nFlipPos[] = {1, 16, nFileSize / 2, nFileSize - 1};
+    for (unsigned int i = 0; i < sizeof(nFlipPos) / sizeof(nFlipPos[0]); i++) {
+        BOOST_CHECK(flatdb.Dump(data));
+
+        FILE* file = fopen(TestFilePath().string().c_str(), "r+b");
+        BOOST_REQUIRE(file != NULL);
+        BOOST_REQUIRE(fseek(file, nFlipPos[i], SEEK_SET) == 0);
+        int ch = fgetc(file);
+        BOOST_REQUIRE(fseek(file, nFlipPos[i], SEEK_SET) == 0);
+        fputc(ch ^ 0x20, file);
+        fclose(file);
+
+        CFlatDBTestData dataLoaded;
+        BOOST_CHECK(!flatdb.Load(dataLoaded));
+        BOOST_CHECK(dataLoaded.vecItems.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_format_changed)
+{
+    CFlatDB<CFlatDBTestData> flatdb(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestData data = CreateData(1000);
+    BOOST_CHECK(flatdb.Dump(data));
+
+    // intact data in an old format is dropped and recreated
+    CFlatDB<CFlatDBTestDataV2> flatdbV2(FLATDB_TEST_FILE, FLATDB_TEST_MAGIC);
+    CFlatDBTestDataV2 dataLoaded;
+    BOOST_CHECK(flatdbV2.Load(dataLoaded));
+    BOOST_CHECK(dataLoaded.vecItems.empty());
+
+    // somebody else's file is left alone
+    CFlatDB<CFlatDBTestData> flatdbOther(FLATDB_TEST_FILE, "OtherMagic");
+    CFlatDBTestData dataOther;
+    BOOST_CHECK(!flatdbOther.Load(dataOther));
+    BOOST_CHECK(!flatdbOther.Dump(data));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
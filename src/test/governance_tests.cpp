@@ -0,0 +1,199 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance.h"
+
+#include "chainparams.h"
+#include "governance-vote.h"
+#include "key.h"
+#include "net.h"
+#include "random.h"
+#include "safenodeman.h"
+#include "streams.h"
+#include "test/test_safenode.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct GovernanceSetup : public TestingSetup {
+    std::vector<CSafenode> vecSafenodes;
+    std::vector<CKey> vecKeys;
+
+    GovernanceSetup()
+    {
+        for (int i = 0; i < 3; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            CService addr(strprintf("1.2.3.%d:9999", i + 1));
+            CSafenode mn(addr, CTxIn(COutPoint(GetRandHash(), 0)), key.GetPubKey(), key.GetPubKey(), PROTOCOL_VERSION);
+            vecSafenodes.push_back(mn);
+            vecKeys.push_back(key);
+            mnodeman.Add(mn);
+        }
+    }
+
+    ~GovernanceSetup()
+    {
+        governance.Clear();
+        mnodeman.Clear();
+        SetMockTime(0);
+    }
+
+    // A watchdog only needs a safenode signature, no collateral
+    uint256 AddWatchdog()
+    {
+        std::string strData = "[[\"watchdog\",{\"type\":3}]]";
+        CGovernanceObject govobj(uint256(), 1, GetAdjustedTime(), uint256(), HexStr(strData.begin(), strData.end()));
+        CPubKey pubKey = vecKeys[0].GetPubKey();
+        govobj.SetSafenodeInfo(vecSafenodes[0].vin);
+        BOOST_CHECK(govobj.Sign(vecKeys[0], pubKey));
+        bool fAddToSeen = false;
+        BOOST_CHECK(governance.AddGovernanceObject(govobj, fAddToSeen));
+        return govobj.GetHash();
+    }
+
+    bool Vote(int nSafenode, const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime = 0)
+    {
+        CGovernanceVote vote(vecSafenodes[nSafenode].vin, nParentHash, eSignal, eOutcome);
+        if (nTime)
+            vote.SetTime(nTime);
+        CPubKey pubKey = vecKeys[nSafenode].GetPubKey();
+        BOOST_CHECK(vote.Sign(vecKeys[nSafenode], pubKey));
+        CGovernanceException exception;
+        return governance.ProcessVoteAndRelay(vote, exception);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, GovernanceSetup)
+
+BOOST_AUTO_TEST_CASE(governance_vote_tally)
+{
+    SetMockTime(GetTime());
+    uint256 nHash = AddWatchdog();
+    CGovernanceObject* pGovObj = governance.FindGovernanceObject(nHash);
+    BOOST_REQUIRE(pGovObj != NULL);
+
+    // cast
+    BOOST_CHECK(Vote(0, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    BOOST_CHECK(Vote(1, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    BOOST_CHECK(Vote(2, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+    BOOST_CHECK(Vote(0, nHash, VOTE_SIGNAL_VALID, VOTE_OUTCOME_YES));
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_VALID), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_DELETE), 0);
+
+    // update, the old outcome no longer counts
+    SetMockTime(GetTime() + GOVERNANCE_UPDATE_MIN + 1);
+    BOOST_CHECK(Vote(1, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(pGovObj->GetAbsoluteNoCount(VOTE_SIGNAL_FUNDING), 1);
+
+    // an obsolete vote is rejected and doesn't change anything
+    BOOST_CHECK(!Vote(1, nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_ABSTAIN, GetTime() - 10));
+    BOOST_CHECK_EQUAL(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(pGovObj->GetAbstainCount(VOTE_SIGNAL_FUNDING), 0);
+
+    // remove the third safenode, its votes are dropped
+    mnodeman.Clear();
+    mnodeman.Add(vecSafenodes[0]);
+    mnodeman.Add(vecSafenodes[1]);
+    mnodeman.AddDirtyGovernanceObjectHash(nHash);
+    governance.UpdateCachesAndClean();
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(pGovObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(pGovObj->GetYesCount(VOTE_SIGNAL_VALID), 1);
+
+    // the tallies are recounted when the object is loaded
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << *pGovObj;
+    CGovernanceObject govobjLoaded;
+    ss >> govobjLoaded;
+    BOOST_CHECK_EQUAL(govobjLoaded.GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobjLoaded.GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobjLoaded.GetYesCount(VOTE_SIGNAL_VALID), 1);
+}
+
+BOOST_AUTO_TEST_CASE(governance_vote_digests)
+{
+    std::vector<uint256> vecHashes;
+    for (int i = 0; i < 100; i++)
+        vecHashes.push_back(GetRandHash());
+
+    // no votes, no difference
+    std::vector<uint64_t> vecEmpty = GetGovernanceVoteDigests(std::vector<uint256>(), 16);
+    BOOST_CHECK_EQUAL(vecEmpty.size(), 16);
+    BOOST_CHECK(std::count(vecEmpty.begin(), vecEmpty.end(), 0) == 16);
+
+    // the order of the votes doesn't matter
+    std::vector<uint64_t> vecDigests = GetGovernanceVoteDigests(vecHashes, 16);
+    std::vector<uint256> vecReversed(vecHashes.rbegin(), vecHashes.rend());
+    BOOST_CHECK(GetGovernanceVoteDigests(vecReversed, 16) == vecDigests);
+
+    // a missing vote changes the digest of its bucket only
+    std::vector<uint256> vecMissing(vecHashes.begin() + 1, vecHashes.end());
+    std::vector<uint64_t> vecMissingDigests = GetGovernanceVoteDigests(vecMissing, 16);
+    size_t nBucket = vecHashes[0].GetCheapHash() % 16;
+    for (size_t i = 0; i < vecDigests.size(); i++) {
+        BOOST_CHECK_EQUAL(vecDigests[i] != vecMissingDigests[i], i == nBucket);
+    }
+    BOOST_CHECK_EQUAL(vecDigests[nBucket] ^ vecMissingDigests[nBucket], vecHashes[0].GetUint64(1));
+}
+
+static std::set<uint256> GetInventoryToSend(CNode& node)
+{
+    std::set<uint256> setHashes;
+    for (size_t i = 0; i < node.vInventoryToSend.size(); i++) {
+        BOOST_CHECK_EQUAL(node.vInventoryToSend[i].type, MSG_GOVERNANCE_OBJECT_VOTE);
+        setHashes.insert(node.vInventoryToSend[i].hash);
+    }
+    node.vInventoryToSend.clear();
+    return setHashes;
+}
+
+BOOST_AUTO_TEST_CASE(governance_sync_votes_by_digest)
+{
+    uint256 nHash = AddWatchdog();
+    const vote_signal_enum_t eSignals[] = {VOTE_SIGNAL_FUNDING, VOTE_SIGNAL_VALID, VOTE_SIGNAL_DELETE, VOTE_SIGNAL_ENDORSED};
+    for (int i = 0; i < (int)vecSafenodes.size(); i++) {
+        for (int j = 0; j < 4; j++) {
+            BOOST_CHECK(Vote(i, nHash, eSignals[j], VOTE_OUTCOME_YES));
+        }
+    }
+    std::vector<uint256> vecHashes = governance.FindGovernanceObject(nHash)->GetVoteFile().GetVoteHashes();
+    BOOST_REQUIRE_EQUAL(vecHashes.size(), 12);
+
+    CAddress addr(CService("10.0.0.1", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+
+    // a peer with all our votes gets nothing
+    governance.SyncVotesByDigest(&node, nHash, GetGovernanceVoteDigests(vecHashes, 4));
+    BOOST_CHECK(GetInventoryToSend(node).empty());
+
+    // a peer without votes gets all of them
+    governance.SyncVotesByDigest(&node, nHash, std::vector<uint64_t>());
+    std::set<uint256> setSent = GetInventoryToSend(node);
+    BOOST_CHECK(setSent == std::set<uint256>(vecHashes.begin(), vecHashes.end()));
+
+    // a peer missing one vote gets the votes of that bucket
+    std::vector<uint256> vecPeerHashes(vecHashes.begin() + 1, vecHashes.end());
+    governance.SyncVotesByDigest(&node, nHash, GetGovernanceVoteDigests(vecPeerHashes, 4));
+    setSent = GetInventoryToSend(node);
+    BOOST_CHECK(setSent.count(vecHashes[0]));
+    size_t nBucket = vecHashes[0].GetCheapHash() % 4;
+    for (size_t i = 0; i < vecHashes.size(); i++) {
+        BOOST_CHECK_EQUAL(setSent.count(vecHashes[i]) != 0, vecHashes[i].GetCheapHash() % 4 == nBucket);
+    }
+
+    // unknown objects are ignored
+    governance.SyncVotesByDigest(&node, GetRandHash(), std::vector<uint64_t>());
+    BOOST_CHECK(GetInventoryToSend(node).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
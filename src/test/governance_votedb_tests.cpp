@@ -0,0 +1,155 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+
+#include "random.h"
+#include "test/test_safenode.h"
+#include "util.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct GovernanceVoteDBSetup : public TestingSetup {
+    GovernanceVoteDBSetup()
+    {
+        pgovernancevotedb = new CGovernanceVoteDB(1 << 20, true);
+    }
+    ~GovernanceVoteDBSetup()
+    {
+        delete pgovernancevotedb;
+        pgovernancevotedb = NULL;
+    }
+};
+
+static CGovernanceVote CreateVote(const CTxIn& vinSafenode, const uint256& nParentHash, int64_t nTime)
+{
+    CGovernanceVote vote(vinSafenode, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, GovernanceVoteDBSetup)
+
+BOOST_AUTO_TEST_CASE(votedb_add_get_remove)
+{
+    CTxIn vin1(COutPoint(GetRandHash(), 0));
+    CTxIn vin2(COutPoint(GetRandHash(), 1));
+    uint256 nParentHash = GetRandHash();
+    uint256 nOtherParentHash = GetRandHash();
+
+    CGovernanceVote vote1 = CreateVote(vin1, nParentHash, 1000);
+    CGovernanceVote vote2 = CreateVote(vin1, nParentHash, 2000);
+    CGovernanceVote vote3 = CreateVote(vin2, nParentHash, 1000);
+    CGovernanceVote voteOther = CreateVote(vin1, nOtherParentHash, 1000);
+    BOOST_CHECK(pgovernancevotedb->WriteVote(vote1));
+    BOOST_CHECK(pgovernancevotedb->WriteVote(vote2));
+    BOOST_CHECK(pgovernancevotedb->WriteVote(vote3));
+    BOOST_CHECK(pgovernancevotedb->WriteVote(voteOther));
+
+    CGovernanceVote voteRead;
+    BOOST_CHECK(pgovernancevotedb->HaveVote(vote1.GetHash()));
+    BOOST_CHECK(pgovernancevotedb->ReadVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(voteRead == vote1);
+    BOOST_CHECK(!pgovernancevotedb->HaveVote(GetRandHash()));
+
+    std::vector<uint256> vecHashes;
+    BOOST_CHECK(pgovernancevotedb->ReadVoteHashes(nParentHash, vecHashes));
+    BOOST_CHECK_EQUAL(vecHashes.size(), 3);
+    BOOST_CHECK(std::find(vecHashes.begin(), vecHashes.end(), voteOther.GetHash()) == vecHashes.end());
+
+    // votes of one safenode on the object
+    std::vector<CGovernanceVoteDB::vote_key_t> vecKeys;
+    BOOST_CHECK(pgovernancevotedb->ReadVoteKeys(nParentHash, vin1.prevout, vecKeys));
+    BOOST_CHECK_EQUAL(vecKeys.size(), 2);
+    for (size_t i = 0; i < vecKeys.size(); i++) {
+        BOOST_CHECK(vecKeys[i].first == vin1.prevout);
+        BOOST_CHECK(vecKeys[i].second == vote1.GetHash() || vecKeys[i].second == vote2.GetHash());
+    }
+
+    std::vector<std::pair<uint256, CGovernanceVoteDB::vote_key_t> > vecAllKeys;
+    BOOST_CHECK(pgovernancevotedb->ReadAllVoteKeys(vecAllKeys));
+    BOOST_CHECK_EQUAL(vecAllKeys.size(), 4);
+
+    BOOST_CHECK(pgovernancevotedb->EraseVotes(nParentHash, vecKeys));
+    BOOST_CHECK(!pgovernancevotedb->HaveVote(vote1.GetHash()));
+    BOOST_CHECK(!pgovernancevotedb->HaveVote(vote2.GetHash()));
+    BOOST_CHECK(pgovernancevotedb->HaveVote(vote3.GetHash()));
+    BOOST_CHECK(pgovernancevotedb->HaveVote(voteOther.GetHash()));
+
+    vecHashes.clear();
+    BOOST_CHECK(pgovernancevotedb->ReadVoteHashes(nParentHash, vecHashes));
+    BOOST_CHECK_EQUAL(vecHashes.size(), 1);
+    BOOST_CHECK(vecHashes[0] == vote3.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(votefile_database)
+{
+    std::vector<CTxIn> vecVins;
+    for (int i = 0; i < 3; i++)
+        vecVins.push_back(CTxIn(COutPoint(GetRandHash(), i)));
+    uint256 nParentHash = GetRandHash();
+
+    // more votes than are held in memory
+    CGovernanceObjectVoteFile fileVotes;
+    std::vector<CGovernanceVote> vecVotes;
+    for (int i = 0; i < 150; i++) {
+        vecVotes.push_back(CreateVote(vecVins[i % 3], nParentHash, 1000 + i));
+        fileVotes.AddVote(vecVotes.back());
+    }
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 150);
+    BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 150);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteHashes().size(), 150);
+
+    // the oldest ones are read back from the database
+    CGovernanceVote voteRead;
+    BOOST_CHECK(fileVotes.HasVote(vecVotes[0].GetHash()));
+    BOOST_CHECK(fileVotes.GetVote(vecVotes[0].GetHash(), voteRead));
+    BOOST_CHECK(voteRead == vecVotes[0]);
+    BOOST_CHECK(fileVotes.GetVote(vecVotes[149].GetHash(), voteRead));
+    BOOST_CHECK(voteRead == vecVotes[149]);
+
+    fileVotes.RemoveVotesFromSafenode(vecVins[0]);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 100);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteHashes().size(), 100);
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        BOOST_CHECK_EQUAL(fileVotes.HasVote(vecVotes[i].GetHash()), i % 3 != 0);
+    }
+
+    fileVotes.RemoveAllVotes();
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 0);
+    BOOST_CHECK(fileVotes.GetVotes().empty());
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        BOOST_CHECK(!pgovernancevotedb->HaveVote(vecVotes[i].GetHash()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(votedb_clean_flag)
+{
+    CGovernanceVote vote = CreateVote(CTxIn(COutPoint(GetRandHash(), 0)), GetRandHash(), 1000);
+
+    // a database that was never marked clean isn't
+    boost::filesystem::create_directories(GetDataDir() / "governance");
+    CGovernanceVoteDB* pdb = new CGovernanceVoteDB(1 << 20);
+    BOOST_CHECK(!pdb->IsClean());
+    BOOST_CHECK(pdb->WriteVote(vote));
+    BOOST_CHECK(pdb->WriteClean(true));
+    BOOST_CHECK(pdb->IsClean());
+    delete pdb;
+
+    // the flag and the votes survive a restart
+    pdb = new CGovernanceVoteDB(1 << 20);
+    BOOST_CHECK(pdb->IsClean());
+    BOOST_CHECK(pdb->HaveVote(vote.GetHash()));
+    BOOST_CHECK(pdb->WriteClean(false));
+    BOOST_CHECK(!pdb->IsClean());
+    delete pdb;
+
+    // wiping it drops both
+    pdb = new CGovernanceVoteDB(1 << 20, false, true);
+    BOOST_CHECK(!pdb->IsClean());
+    BOOST_CHECK(!pdb->HaveVote(vote.GetHash()));
+    delete pdb;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
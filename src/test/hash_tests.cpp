@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_safenode.h"
 
@@ -47,4 +48,34 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(hashing_writer_and_verifier)
+{
+    std::vector<unsigned char> vch = ParseHex("00112233445566778899aabbccddeeff");
+    std::string str("streamed");
+
+    CHashWriter hasher(SER_DISK, 0);
+    hasher << vch << str;
+    uint256 hashExpected = hasher.GetHash();
+
+    // the hashing writer passes the data through unchanged and hashes it on the way
+    CDataStream ss(SER_DISK, 0);
+    CHashingWriter<CDataStream> writer(&ss);
+    writer << vch << str;
+    BOOST_CHECK(writer.GetHash() == hashExpected);
+
+    CDataStream ssExpected(SER_DISK, 0);
+    ssExpected << vch << str;
+    BOOST_CHECK(ss.str() == ssExpected.str());
+
+    // and the verifier gets the same hash back while reading it
+    std::vector<unsigned char> vchRead;
+    std::string strRead;
+    CHashVerifier<CDataStream> verifier(&ss);
+    verifier >> vchRead >> strRead;
+    BOOST_CHECK(vchRead == vch);
+    BOOST_CHECK_EQUAL(strRead, str);
+    BOOST_CHECK(verifier.GetHash() == hashExpected);
+    BOOST_CHECK(ss.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "main.h"
+#include "miner.h"
+#include "pow.h"
+#include "streams.h"
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct LoadBlockSetup : public TestChain100Setup {
+    // Create nCount blocks on top of the tip without processing them
+    std::vector<CBlock> CreateBlocks(int nCount)
+    {
+        const CChainParams& chainparams = Params();
+        CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+        CBlockTemplate *pblocktemplate = CreateNewBlock(chainparams, scriptPubKey);
+
+        std::vector<CBlock> blocks;
+        uint256 hashPrev = chainActive.Tip()->GetBlockHash();
+        for (int i = 0; i < nCount; i++) {
+            CBlock block = pblocktemplate->block;
+            block.hashPrevBlock = hashPrev;
+            block.nTime += i + 1;
+            CMutableTransaction coinbase(block.vtx[0]);
+            coinbase.vin[0].scriptSig = CScript() << (chainActive.Height() + 1 + i) << OP_0;
+            block.vtx[0] = coinbase;
+            block.hashMerkleRoot = BlockMerkleRoot(block);
+            while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+            hashPrev = block.GetHash();
+            blocks.push_back(block);
+        }
+        delete pblocktemplate;
+        return blocks;
+    }
+
+    // Write blocks in the given order in the format of the blk*.dat files
+    void WriteBlocks(FILE* file, const std::vector<CBlock>& blocks, const int* order)
+    {
+        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            const CBlock& block = blocks[order[i]];
+            unsigned int nSize = fileout.GetSerializeSize(block);
+            fileout << FLATDATA(Params().MessageStart()) << nSize << block;
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(loadblock_tests, LoadBlockSetup)
+
+// Out of order blocks in both import batches (IMPORT_HASH_BATCH is 4)
+static const int BLOCK_ORDER[] = {0, 2, 1, 3, 5, 4};
+
+BOOST_AUTO_TEST_CASE(loadblock_roundtrip)
+{
+    const CChainParams& chainparams = Params();
+    std::vector<CBlock> blocks = CreateBlocks(6);
+    int nHeight = chainActive.Height();
+
+    boost::filesystem::path path = GetDataDir() / "bootstrap.dat";
+    WriteBlocks(fopen(path.string().c_str(), "wb"), blocks, BLOCK_ORDER);
+
+    // -loadblock doesn't know where blocks are on disk, so a block whose parent
+    // comes later in the file is skipped and picked up by a later load
+    const int nExpectedTip[] = {1, 4, 5};
+    for (int i = 0; i < 3; i++) {
+        BOOST_CHECK(LoadExternalBlockFile(chainparams, fopen(path.string().c_str(), "rb")));
+        BOOST_CHECK_EQUAL(chainActive.Height(), nHeight + nExpectedTip[i] + 1);
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks[nExpectedTip[i]].GetHash());
+    }
+
+    // everything known now, nothing more to load
+    BOOST_CHECK(!LoadExternalBlockFile(chainparams, fopen(path.string().c_str(), "rb")));
+    BOOST_CHECK_EQUAL(chainActive.Height(), nHeight + 6);
+}
+
+BOOST_AUTO_TEST_CASE(reindex_out_of_order)
+{
+    const CChainParams& chainparams = Params();
+    std::vector<CBlock> blocks = CreateBlocks(6);
+    int nHeight = chainActive.Height();
+
+    // as for -reindex, out of order blocks are read back from the block file
+    // once their parent has been processed
+    CDiskBlockPos pos(1, 0);
+    WriteBlocks(OpenBlockFile(pos), blocks, BLOCK_ORDER);
+    BOOST_CHECK(LoadExternalBlockFile(chainparams, OpenBlockFile(pos, true), &pos));
+    BOOST_CHECK_EQUAL(chainActive.Height(), nHeight + 6);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == blocks[5].GetHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -473,4 +473,83 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+static CScript GetPayToPubKeyHash(const uint160& hash)
+{
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    uint160 hashA(std::vector<unsigned char>(20, 0x0a));
+    uint160 hashB(std::vector<unsigned char>(20, 0x0b));
+    uint160 hashC(std::vector<unsigned char>(20, 0x0c));
+
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    txParent.vout[0].scriptPubKey = GetPayToPubKeyHash(hashA);
+    txParent.vout[0].nValue = 5 * COIN;
+    txParent.vout[1].scriptPubKey = GetPayToPubKeyHash(hashA);
+    txParent.vout[1].nValue = 2 * COIN;
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    view.ModifyCoins(txParent.GetHash())->FromTx(txParent, 1);
+
+    // pays B and sends change back to A
+    CMutableTransaction tx1;
+    tx1.vin.resize(1);
+    tx1.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    tx1.vout.resize(2);
+    tx1.vout[0].scriptPubKey = GetPayToPubKeyHash(hashB);
+    tx1.vout[0].nValue = 3 * COIN;
+    tx1.vout[1].scriptPubKey = GetPayToPubKeyHash(hashA);
+    tx1.vout[1].nValue = 2 * COIN;
+
+    // pays the P2SH address C
+    CMutableTransaction tx2;
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(txParent.GetHash(), 1);
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_HASH160 << ToByteVector(hashC) << OP_EQUAL;
+    tx2.vout[0].nValue = 2 * COIN;
+
+    CTxMemPool testPool(CFeeRate(0));
+    testPool.addAddressIndex(entry.FromTx(tx1), view);
+    testPool.addAddressIndex(entry.FromTx(tx2), view);
+
+    std::vector<std::pair<uint160, int> > addresses;
+    addresses.push_back(std::make_pair(hashA, 1));
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+    BOOST_CHECK(testPool.getAddressIndex(addresses, results));
+    BOOST_CHECK_EQUAL(results.size(), 3U);
+    CAmount nTotal = 0;
+    for (size_t i = 0; i < results.size(); i++)
+        nTotal += results[i].second.amount;
+    BOOST_CHECK_EQUAL(nTotal, -5 * COIN);
+
+    // several addresses at once, the wrong type and unknown addresses match nothing
+    addresses.push_back(std::make_pair(hashB, 1));
+    addresses.push_back(std::make_pair(hashC, 2));
+    addresses.push_back(std::make_pair(hashC, 1));
+    addresses.push_back(std::make_pair(uint160(std::vector<unsigned char>(20, 0x0d)), 1));
+    results.clear();
+    BOOST_CHECK(testPool.getAddressIndex(addresses, results));
+    BOOST_CHECK_EQUAL(results.size(), 5U);
+
+    testPool.removeAddressIndex(tx1.GetHash());
+    results.clear();
+    BOOST_CHECK(testPool.getAddressIndex(addresses, results));
+    BOOST_CHECK_EQUAL(results.size(), 2U);
+    for (size_t i = 0; i < results.size(); i++)
+        BOOST_CHECK(results[i].first.txhash == tx2.GetHash());
+
+    testPool.removeAddressIndex(tx2.GetHash());
+    results.clear();
+    BOOST_CHECK(testPool.getAddressIndex(addresses, results));
+    BOOST_CHECK(results.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,43 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigcache.h"
+
+#include "pubkey.h"
+#include "uint256.h"
+
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigcache_test)
+{
+    uint256 hash = uint256S("0x5b8bd2d7b4b9ae46a0a7a2a07a8b8e2a0b8d1d4a1e0fe7a83d8e1d29e38a0c41");
+    std::vector<unsigned char> vchSig(65, 0x01);
+    CKeyID keyID(uint160(std::vector<unsigned char>(20, 0x02)));
+
+    message_sig_cache_stats_t statsBefore = GetMessageSigCacheStats();
+
+    // not there yet
+    BOOST_CHECK(!IsMessageSignatureCached(hash, vchSig, keyID));
+
+    AddMessageSignatureToCache(hash, vchSig, keyID);
+    BOOST_CHECK(IsMessageSignatureCached(hash, vchSig, keyID));
+
+    // any other signature, key or message is a miss
+    std::vector<unsigned char> vchSigOther(vchSig);
+    vchSigOther[64] ^= 1;
+    BOOST_CHECK(!IsMessageSignatureCached(hash, vchSigOther, keyID));
+    BOOST_CHECK(!IsMessageSignatureCached(hash, vchSig, CKeyID()));
+    BOOST_CHECK(!IsMessageSignatureCached(uint256(), vchSig, keyID));
+
+    message_sig_cache_stats_t statsAfter = GetMessageSigCacheStats();
+    BOOST_CHECK(statsAfter.nHits == statsBefore.nHits + 1);
+    BOOST_CHECK(statsAfter.nMisses == statsBefore.nMisses + 4);
+    BOOST_CHECK(statsAfter.nEntries == statsBefore.nEntries + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
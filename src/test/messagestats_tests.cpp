@@ -0,0 +1,73 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagestats.h"
+
+#include "protocol.h"
+
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagestats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(timehistogram_test)
+{
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(0), 0);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(9), 0);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(10), 1);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(999), 2);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(1000), 3);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(9999999), 6);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(10000000), 7);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucket(1000000000000LL), 7);
+
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucketLimit(0), 10);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucketLimit(6), 10000000);
+    BOOST_CHECK_EQUAL(CTimeHistogram::GetBucketLimit(7), -1);
+
+    CTimeHistogram hist;
+    hist.Add(5);
+    hist.Add(50);
+    hist.Add(55);
+    // clock going backwards counts as zero
+    hist.Add(-3);
+    BOOST_CHECK_EQUAL(hist.nCount, 4U);
+    BOOST_CHECK_EQUAL(hist.nTotalMicros, 110);
+    BOOST_CHECK_EQUAL(hist.nMaxMicros, 55);
+    BOOST_CHECK_EQUAL(hist.vBuckets[0], 2U);
+    BOOST_CHECK_EQUAL(hist.vBuckets[1], 2U);
+    BOOST_CHECK_EQUAL(hist.vBuckets[2], 0U);
+}
+
+BOOST_AUTO_TEST_CASE(messagestats_test)
+{
+    ResetMessageStats();
+
+    RecordMessageStats(NetMsgType::MNPING, 100, 20, 300, 0);
+    RecordMessageStats(NetMsgType::MNPING, 120, 2000, 40, 30);
+    RecordMessageStats("nosuchcmd1", 10, 1, 1, 0);
+    RecordMessageStats("nosuchcmd2", 10, 1, 1, 0);
+
+    std::map<std::string, CMessageStats> mapStats;
+    GetMessageStats(mapStats);
+    // unknown commands end up in a single entry
+    BOOST_CHECK_EQUAL(mapStats.size(), 2U);
+    BOOST_CHECK_EQUAL(mapStats["unknown"].nCount, 2U);
+
+    const CMessageStats& stats = mapStats[NetMsgType::MNPING];
+    BOOST_CHECK_EQUAL(stats.nCount, 2U);
+    BOOST_CHECK_EQUAL(stats.nBytes, 220U);
+    BOOST_CHECK_EQUAL(stats.histQueue.nMaxMicros, 2000);
+    BOOST_CHECK_EQUAL(stats.histProcess.nTotalMicros, 340);
+    BOOST_CHECK_EQUAL(stats.histLockWait.nTotalMicros, 30);
+    BOOST_CHECK_EQUAL(stats.histLockWait.vBuckets[0], 1U);
+    BOOST_CHECK_EQUAL(stats.histLockWait.vBuckets[1], 1U);
+
+    ResetMessageStats();
+    GetMessageStats(mapStats);
+    BOOST_CHECK(mapStats.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
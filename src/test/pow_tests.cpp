@@ -4,6 +4,7 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "hash.h"
 #include "pow.h"
 #include "random.h"
 #include "util.h"
@@ -96,4 +97,109 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1522584000 + 1000; // X16R
+    header.nBits = 0x207fffff;
+    header.nNonce = 0;
+
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK(CBlock(header).GetHash() == hash);
+
+    // mutating any field must invalidate the memoized hash
+    header.nNonce++;
+    uint256 hashBumped = header.GetHash();
+    BOOST_CHECK(hashBumped != hash);
+    CBlockHeader fresh;
+    fresh.nVersion = header.nVersion;
+    fresh.hashPrevBlock = header.hashPrevBlock;
+    fresh.hashMerkleRoot = header.hashMerkleRoot;
+    fresh.nTime = header.nTime;
+    fresh.nBits = header.nBits;
+    fresh.nNonce = header.nNonce;
+    BOOST_CHECK(fresh.GetHash() == hashBumped);
+
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == hash);
+
+    // pre-X16R headers go through NeoScrypt
+    header.nTime = 1522584000;
+    BOOST_CHECK(header.GetHash() != hash);
+}
+
+BOOST_AUTO_TEST_CASE(header_hash_batch)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nBits = 0x207fffff;
+    header.nNonce = 100;
+
+    // X16R headers are batched, NeoScrypt headers hashed one by one
+    const uint32_t times[] = {1522584000 + 1000, 1522584000};
+    for (uint32_t nTime : times) {
+        header.nTime = nTime;
+        uint256 hashes[5];
+        header.GetHashesForNonces(5, hashes);
+        CBlockHeader copy(header);
+        for (int i = 0; i < 5; i++, copy.nNonce++) {
+            BOOST_CHECK(hashes[i] == copy.GetHash());
+        }
+        BOOST_CHECK(header.nNonce == 100);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(header_hash_cache_batch)
+{
+    // Mix of NeoScrypt and X16R headers, with a NeoScrypt count that is not a
+    // multiple of the 4-way batch size
+    std::vector<CBlockHeader> headers(11);
+    std::vector<const CBlockHeader*> vpheaders;
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 4;
+        headers[i].hashPrevBlock = GetRandHash();
+        headers[i].hashMerkleRoot = GetRandHash();
+        headers[i].nTime = (i % 4 == 3) ? 1522584000 + 1000 : 1400000000 + i;
+        headers[i].nBits = 0x207fffff;
+        headers[i].nNonce = insecure_rand();
+        vpheaders.push_back(&headers[i]);
+    }
+
+    CacheBlockHeaderHashes(vpheaders);
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK(headers[i].fHashCached);
+        CBlockHeader fresh(headers[i]);
+        fresh.fHashCached = false;
+        BOOST_CHECK(headers[i].GetHash() == fresh.GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(header_hash_plan_cache)
+{
+    // More parents than the per-thread plan cache holds, revisited in a
+    // different order, so that slots are both reused and replaced
+    std::vector<uint256> parents;
+    for (int i = 0; i < 20; i++)
+        parents.push_back(GetRandHash());
+
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1522584000 + 1000; // X16R
+    header.nBits = 0x207fffff;
+    header.nNonce = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < parents.size(); i++) {
+            header.hashPrevBlock = parents[pass == 0 ? i : parents.size() - 1 - i];
+            BOOST_CHECK(header.GetHash() == HashX16R(BEGIN(header.nVersion), END(header.nNonce), header.hashPrevBlock));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,208 @@
+// Copyright (c) 2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "safenodeman.h"
+
+#include "key.h"
+#include "main.h"
+#include "random.h"
+#include "safenode-payments.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(safenodeman_tests, BasicTestingSetup)
+
+static CPubKey NewPubKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey();
+}
+
+static CSafenode CreateSafenode(int n, const CPubKey& pubKeySafenode = NewPubKey())
+{
+    CService addr(strprintf("1.2.%d.%d:9999", n / 256, n % 256));
+    CTxIn vin(COutPoint(GetRandHash(), n));
+    return CSafenode(addr, vin, NewPubKey(), pubKeySafenode, PROTOCOL_VERSION);
+}
+
+static CScript GetPayee(const CSafenode& mn)
+{
+    return GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
+}
+
+BOOST_AUTO_TEST_CASE(safenodeman_lookup)
+{
+    CSafenodeMan man;
+    std::vector<CSafenode> vecSafenodes;
+    for (int i = 0; i < 20; i++) {
+        vecSafenodes.push_back(CreateSafenode(i));
+        BOOST_CHECK(man.Add(vecSafenodes.back()));
+    }
+    BOOST_CHECK_EQUAL(man.size(), 20);
+
+    // the same collateral can't be added twice
+    CSafenode mnDup(vecSafenodes[3]);
+    mnDup.pubKeySafenode = NewPubKey();
+    BOOST_CHECK(!man.Add(mnDup));
+    BOOST_CHECK_EQUAL(man.size(), 20);
+
+    BOOST_FOREACH(const CSafenode& mn, vecSafenodes) {
+        CSafenode* pmn = man.Find(mn.vin);
+        BOOST_REQUIRE(pmn != NULL);
+        BOOST_CHECK(pmn->vin == mn.vin);
+        BOOST_CHECK(man.Find(mn.pubKeySafenode) == pmn);
+        BOOST_CHECK(man.Find(GetPayee(mn)) == pmn);
+        BOOST_CHECK(man.Has(mn.vin));
+
+        CSafenode mnCopy;
+        BOOST_CHECK(man.Get(mn.pubKeySafenode, mnCopy));
+        BOOST_CHECK(mnCopy.vin == mn.vin);
+    }
+
+    CSafenode mnUnknown = CreateSafenode(100);
+    BOOST_CHECK(man.Find(mnUnknown.vin) == NULL);
+    BOOST_CHECK(man.Find(mnUnknown.pubKeySafenode) == NULL);
+    BOOST_CHECK(man.Find(GetPayee(mnUnknown)) == NULL);
+    BOOST_CHECK(!man.Has(mnUnknown.vin));
+}
+
+BOOST_AUTO_TEST_CASE(safenodeman_shared_key)
+{
+    // several safenodes can run with the same safenode key, each stays findable by outpoint
+    CSafenodeMan man;
+    CPubKey pubKeySafenode = NewPubKey();
+    CSafenode mn1 = CreateSafenode(1, pubKeySafenode);
+    CSafenode mn2 = CreateSafenode(2, pubKeySafenode);
+    BOOST_CHECK(man.Add(mn1));
+    BOOST_CHECK(man.Add(mn2));
+
+    CSafenode* pmn = man.Find(pubKeySafenode);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn->vin == mn1.vin || pmn->vin == mn2.vin);
+    BOOST_CHECK(man.Find(mn1.vin)->vin == mn1.vin);
+    BOOST_CHECK(man.Find(mn2.vin)->vin == mn2.vin);
+}
+
+BOOST_AUTO_TEST_CASE(safenodeman_pointers_stable)
+{
+    CSafenodeMan man;
+    CSafenode mn = CreateSafenode(0);
+    man.Add(mn);
+    CSafenode* pmn = man.Find(mn.vin);
+
+    // entries are not moved when others are added
+    for (int i = 1; i < 1000; i++) {
+        CSafenode mnOther = CreateSafenode(i);
+        man.Add(mnOther);
+    }
+    BOOST_CHECK(man.Find(mn.vin) == pmn);
+    BOOST_CHECK(man.Find(mn.pubKeySafenode) == pmn);
+}
+
+BOOST_AUTO_TEST_CASE(safenodeman_serialize)
+{
+    CSafenodeMan man;
+    std::vector<CSafenode> vecSafenodes;
+    for (int i = 0; i < 10; i++) {
+        vecSafenodes.push_back(CreateSafenode(i));
+        man.Add(vecSafenodes.back());
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CSafenodeMan manLoaded;
+    ss >> manLoaded;
+
+    // the lookup maps are rebuilt and point into the loaded list
+    BOOST_CHECK_EQUAL(manLoaded.size(), 10);
+    BOOST_FOREACH(const CSafenode& mn, vecSafenodes) {
+        CSafenode* pmn = manLoaded.Find(mn.vin);
+        BOOST_REQUIRE(pmn != NULL);
+        BOOST_CHECK(pmn != man.Find(mn.vin));
+        BOOST_CHECK(manLoaded.Find(mn.pubKeySafenode) == pmn);
+        BOOST_CHECK(manLoaded.Find(GetPayee(mn)) == pmn);
+    }
+
+    manLoaded.Clear();
+    BOOST_CHECK_EQUAL(manLoaded.size(), 0);
+    BOOST_FOREACH(const CSafenode& mn, vecSafenodes) {
+        BOOST_CHECK(manLoaded.Find(mn.vin) == NULL);
+        BOOST_CHECK(manLoaded.Find(mn.pubKeySafenode) == NULL);
+        BOOST_CHECK(manLoaded.Find(GetPayee(mn)) == NULL);
+    }
+}
+
+// Safenodes with collateral old enough to be paid on top of TestChain100Setup
+static void AddPaymentQueue(CSafenodeMan& man, std::vector<CSafenode>& vecSafenodes, int nSafenodes)
+{
+    for (int i = 0; i < nSafenodes; i++) {
+        CSafenode mn = CreateSafenode(i);
+        mn.nBlockLastPaid = 50 - i;
+        mn.nCacheCollateralBlock = 1;
+        BOOST_CHECK(man.Add(mn));
+        vecSafenodes.push_back(mn);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(safenodeman_payment_queue, TestChain100Setup)
+{
+    CSafenodeMan man;
+    std::vector<CSafenode> vecSafenodes;
+    AddPaymentQueue(man, vecSafenodes, 10);
+    int nBlockHeight = chainActive.Height() + 1;
+    int nCount = 0;
+
+    // with less than 20 safenodes the least recently paid one wins
+    CSafenode* pmn = man.GetNextSafenodeInQueueForPayment(nBlockHeight, false, nCount);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn->vin == vecSafenodes[9].vin);
+    BOOST_CHECK_EQUAL(nCount, 1);
+
+    // the whole queue is only walked when asked to
+    pmn = man.GetNextSafenodeInQueueForPayment(nBlockHeight, false, nCount, true);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn->vin == vecSafenodes[9].vin);
+    BOOST_CHECK_EQUAL(nCount, 10);
+
+    // disabled and outdated safenodes are skipped
+    man.Find(vecSafenodes[9].vin)->nActiveState = CSafenode::SAFENODE_POSE_BAN;
+    man.Find(vecSafenodes[8].vin)->nProtocolVersion = MIN_SAFENODE_PAYMENT_PROTO_VERSION_1 - 1;
+    pmn = man.GetNextSafenodeInQueueForPayment(nBlockHeight, false, nCount, true);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn->vin == vecSafenodes[7].vin);
+    BOOST_CHECK_EQUAL(nCount, 8);
+
+    // all of them just started, the sigTime filter is dropped rather than paying no one
+    pmn = man.GetNextSafenodeInQueueForPayment(nBlockHeight, true, nCount);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn->vin == vecSafenodes[7].vin);
+
+    // no block to calculate the score from
+    BOOST_CHECK(man.GetNextSafenodeInQueueForPayment(nBlockHeight + 101, false, nCount) == NULL);
+}
+
+BOOST_FIXTURE_TEST_CASE(safenodeman_payment_queue_serialize, TestChain100Setup)
+{
+    CSafenodeMan man;
+    std::vector<CSafenode> vecSafenodes;
+    AddPaymentQueue(man, vecSafenodes, 10);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CSafenodeMan manLoaded;
+    ss >> manLoaded;
+
+    // the queue is rebuilt in the same order
+    int nCount = 0;
+    CSafenode* pmn = manLoaded.GetNextSafenodeInQueueForPayment(chainActive.Height() + 1, false, nCount, true);
+    BOOST_REQUIRE(pmn != NULL);
+    BOOST_CHECK(pmn == manLoaded.Find(vecSafenodes[9].vin));
+    BOOST_CHECK_EQUAL(nCount, 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
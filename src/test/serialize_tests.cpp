@@ -7,6 +7,7 @@
 #include "hash.h"
 #include "test/test_safenode.h"
 
+#include <limits>
 #include <stdint.h>
 
 #include <boost/test/unit_test.hpp>
@@ -160,6 +161,45 @@ BOOST_AUTO_TEST_CASE(varints)
     }
 }
 
+BOOST_AUTO_TEST_CASE(orderedvarints)
+{
+    // every power of two and its neighbours, in increasing order
+    std::vector<uint64_t> values;
+    values.push_back(0);
+    for (int i = 0; i < 64; i++) {
+        uint64_t n = (uint64_t)1 << i;
+        for (uint64_t j = n - 1; j <= n + 1; j++) {
+            if (j > values.back())
+                values.push_back(j);
+        }
+    }
+    values.push_back(std::numeric_limits<uint64_t>::max());
+
+    std::vector<std::string> encoded;
+    for (size_t i = 0; i < values.size(); i++) {
+        CDataStream ss(SER_DISK, 0);
+        WriteOrderedVarInt(ss, values[i]);
+        BOOST_CHECK_EQUAL(ss.size(), GetSizeOfOrderedVarInt(values[i]));
+        encoded.push_back(ss.str());
+        BOOST_CHECK_EQUAL(ReadOrderedVarInt(ss), values[i]);
+        BOOST_CHECK(ss.empty());
+    }
+
+    // byte order is numeric order
+    for (size_t i = 1; i < encoded.size(); i++)
+        BOOST_CHECK_MESSAGE(encoded[i - 1] < encoded[i], "value:" << values[i]);
+
+    BOOST_CHECK_EQUAL(GetSizeOfOrderedVarInt(127), 1U);
+    BOOST_CHECK_EQUAL(GetSizeOfOrderedVarInt(128), 2U);
+    BOOST_CHECK_EQUAL(GetSizeOfOrderedVarInt(2097151), 3U);
+    BOOST_CHECK_EQUAL(GetSizeOfOrderedVarInt(0xffffffff), 5U);
+
+    // longer forms than needed are rejected
+    CDataStream ss(SER_DISK, 0);
+    ss << (unsigned char)0x80 << (unsigned char)0x05;
+    BOOST_CHECK_THROW(ReadOrderedVarInt(ss), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(compactsize)
 {
     CDataStream ss(SER_DISK, 0);
@@ -0,0 +1,92 @@
+// Copyright (c) 2014-2018 The SafeNode developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "shardedmap.h"
+
+#include "arith_uint256.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include "test/test_safenode.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(shardedmap_tests, BasicTestingSetup)
+
+struct IsOdd
+{
+    bool operator()(const uint256& key, int& value) const
+    {
+        return value % 2;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(shardedmap_test)
+{
+    CShardedMap<uint256, int, 4> mapTest;
+
+    // check that it's empty
+    BOOST_CHECK(mapTest.GetSize() == 0);
+
+    // insert 20 items, keys spread over all the shards
+    for(int i = 0; i < 20; ++i) {
+        BOOST_CHECK(mapTest.Insert(ArithToUint256(i), i));
+    }
+    BOOST_CHECK(mapTest.GetSize() == 20);
+
+    // inserting an existing key doesn't overwrite it
+    BOOST_CHECK(!mapTest.Insert(ArithToUint256(5), 100));
+    int nValue = 0;
+    BOOST_CHECK(mapTest.Get(ArithToUint256(5), nValue));
+    BOOST_CHECK(nValue == 5);
+
+    // but setting it does
+    mapTest.Set(ArithToUint256(5), 100);
+    BOOST_CHECK(mapTest.Get(ArithToUint256(5), nValue));
+    BOOST_CHECK(nValue == 100);
+    BOOST_CHECK(mapTest.GetSize() == 20);
+
+    // erase
+    BOOST_CHECK(mapTest.Erase(ArithToUint256(0)));
+    BOOST_CHECK(!mapTest.Erase(ArithToUint256(0)));
+    BOOST_CHECK(!mapTest.HasKey(ArithToUint256(0)));
+    BOOST_CHECK(!mapTest.Get(ArithToUint256(0), nValue));
+    BOOST_CHECK(mapTest.GetSize() == 19);
+
+    // erase all odd values: 1, 3, ..., 19
+    BOOST_CHECK(mapTest.EraseIf(IsOdd()) == 10);
+    BOOST_CHECK(mapTest.GetSize() == 9);
+    for(int i = 1; i < 20; ++i) {
+        BOOST_CHECK(mapTest.HasKey(ArithToUint256(i)) == (i % 2 == 0));
+    }
+
+    // serialized just like a std::map
+    std::map<uint256, int> mapPlain;
+    for(int i = 2; i < 20; i += 2) {
+        mapPlain[ArithToUint256(i)] = i;
+    }
+    CDataStream ssSharded(SER_DISK, CLIENT_VERSION);
+    CDataStream ssPlain(SER_DISK, CLIENT_VERSION);
+    ssSharded << mapTest;
+    ssPlain << mapPlain;
+    BOOST_CHECK(ssSharded.str() == ssPlain.str());
+    BOOST_CHECK(GetSerializeSize(mapTest, SER_DISK, CLIENT_VERSION) == ssPlain.size());
+
+    // read it back
+    CShardedMap<uint256, int, 4> mapTest2;
+    mapTest2.Insert(ArithToUint256(1000), 1000);
+    ssSharded >> mapTest2;
+    BOOST_CHECK(mapTest2.GetSize() == 9);
+    BOOST_CHECK(!mapTest2.HasKey(ArithToUint256(1000)));
+    for(int i = 2; i < 20; i += 2) {
+        BOOST_CHECK(mapTest2.Get(ArithToUint256(i), nValue));
+        BOOST_CHECK(nValue == i);
+    }
+
+    mapTest2.Clear();
+    BOOST_CHECK(mapTest2.GetSize() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
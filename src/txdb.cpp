@@ -12,6 +12,8 @@
 #include "pow.h"
 #include "uint256.h"
 
+#include <algorithm>
+#include <set>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -21,16 +23,96 @@ using namespace std;
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSINDEX = 'd';
+static const char DB_ADDRESSUNSPENTINDEX = 'U';
+static const char DB_ADDRESSBALANCE = 'A';
 static const char DB_TIMESTAMPINDEX = 's';
-static const char DB_SPENTINDEX = 'p';
+static const char DB_SPENTINDEX = 'P';
 static const char DB_BLOCK_INDEX = 'b';
 
+static const char DB_ADDRESSINDEX_V0 = 'a';
+static const char DB_ADDRESSUNSPENTINDEX_V0 = 'u';
+static const char DB_SPENTINDEX_V0 = 'p';
+
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_INDEX_VERSION = 'V';
+
+/**
+ * Fixed width key layouts of index version 0, only used by UpgradeIndexes().
+ * Heights were big-endian, output indexes little-endian.
+ */
+struct CAddressIndexKeyV0 {
+    CAddressIndexKey key;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 66;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s, nType, nVersion);
+        ser_writedata32be(s, key.blockHeight);
+        ser_writedata32be(s, key.txindex);
+        key.txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, key.index);
+        char f = key.spending;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        key.type = ser_readdata8(s);
+        key.hashBytes.Unserialize(s, nType, nVersion);
+        key.blockHeight = ser_readdata32be(s);
+        key.txindex = ser_readdata32be(s);
+        key.txhash.Unserialize(s, nType, nVersion);
+        key.index = ser_readdata32(s);
+        char f = ser_readdata8(s);
+        key.spending = f;
+    }
+};
+
+struct CAddressUnspentKeyV0 {
+    CAddressUnspentKey key;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 57;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ser_writedata8(s, key.type);
+        key.hashBytes.Serialize(s, nType, nVersion);
+        key.txhash.Serialize(s, nType, nVersion);
+        ser_writedata32(s, key.index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        key.type = ser_readdata8(s);
+        key.hashBytes.Unserialize(s, nType, nVersion);
+        key.txhash.Unserialize(s, nType, nVersion);
+        key.index = ser_readdata32(s);
+    }
+};
+
+struct CSpentIndexKeyV0 {
+    CSpentIndexKey key;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        key.txid.Serialize(s, nType, nVersion);
+        ser_writedata32(s, key.outputIndex);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        key.txid.Unserialize(s, nType, nVersion);
+        key.outputIndex = ser_readdata32(s);
+    }
+};
 
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
@@ -221,10 +303,134 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
+void CBlockTreeDB::UpdateAddressBalances(CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect, bool fErase) {
+    // sum up the rows per address first, a tx touching an address several times counts once
+    std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue> mapDeltas;
+    std::set<std::pair<std::pair<unsigned int, uint160>, uint256> > setAddressTxs;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        // only rows really added or removed by this batch count, so that a block connected
+        // again (e.g. after a crash or by -checklevel=4) doesn't change the balances twice
+        if (Exists(make_pair(DB_ADDRESSINDEX, it->first)) != fErase)
+            continue;
+        std::pair<unsigned int, uint160> address(it->first.type, it->first.hashBytes);
+        CAddressBalanceValue &delta = mapDeltas[address];
+        delta.balance += it->second;
+        if (it->second > 0)
+            delta.received += it->second;
+        if (setAddressTxs.insert(make_pair(address, it->first.txhash)).second)
+            delta.txcount++;
+    }
+
+    int nSign = fErase ? -1 : 1;
+    for (std::map<std::pair<unsigned int, uint160>, CAddressBalanceValue>::const_iterator it=mapDeltas.begin(); it!=mapDeltas.end(); it++) {
+        CAddressIndexIteratorKey key(it->first.first, it->first.second);
+        CAddressBalanceValue balance;
+        Read(make_pair(DB_ADDRESSBALANCE, key), balance);
+        balance.balance += nSign * it->second.balance;
+        balance.received += nSign * it->second.received;
+        balance.txcount += nSign * it->second.txcount;
+        if (balance.txcount > 0)
+            batch.Write(make_pair(DB_ADDRESSBALANCE, key), balance);
+        else
+            batch.Erase(make_pair(DB_ADDRESSBALANCE, key));
+    }
+}
+
+//! Sort addresses into database key order (type first, then hash) and drop duplicates
+static std::vector<std::pair<unsigned int, uint160> > SortAddresses(const std::vector<std::pair<uint160, int> > &addresses) {
+    std::vector<std::pair<unsigned int, uint160> > vSorted;
+    vSorted.reserve(addresses.size());
+    for (std::vector<std::pair<uint160, int> >::const_iterator it=addresses.begin(); it!=addresses.end(); it++)
+        vSorted.push_back(make_pair((unsigned int)it->second, it->first));
+    std::sort(vSorted.begin(), vSorted.end());
+    vSorted.erase(std::unique(vSorted.begin(), vSorted.end()), vSorted.end());
+    return vSorted;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(const std::vector<std::pair<uint160, int> > &addresses,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    std::vector<std::pair<unsigned int, uint160> > vSorted = SortAddresses(addresses);
+
+    // one cursor for all addresses, in key order its seeks only move forward
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    for (std::vector<std::pair<unsigned int, uint160> >::const_iterator it=vSorted.begin(); it!=vSorted.end(); it++) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(it->first, it->second)));
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char,CAddressUnspentKey> key;
+            if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != it->first || key.second.hashBytes != it->second)
+                break;
+            CAddressUnspentValue nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address unspent value");
+            unspentOutputs.push_back(make_pair(key.second, nValue));
+            pcursor->Next();
+        }
+    }
+
+    return true;
+}
+
+//! Move a cursor positioned at (or past the end of) a seek key to the last entry before that key
+static void StepBack(CDBIterator *pcursor) {
+    if (pcursor->Valid())
+        pcursor->Prev();
+    else
+        pcursor->SeekToLast();
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndexPage(uint160 addressHash, int type, const CAddressUnspentKey *pafter,
+                                               bool fReverse, size_t nLimit,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pafter) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, *pafter));
+        std::pair<char,CAddressUnspentKey> key;
+        if (fReverse) {
+            StepBack(pcursor.get());
+        } else if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX &&
+                   key.second.txhash == pafter->txhash && key.second.index == pafter->index) {
+            pcursor->Next();
+        }
+    } else if (fReverse) {
+        // past the largest possible key of the address
+        uint256 txhashMax;
+        memset(txhashMax.begin(), 0xff, txhashMax.size());
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, txhashMax, 0xffffffff)));
+        StepBack(pcursor.get());
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid() && unspentOutputs.size() < nLimit) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(make_pair(key.second, nValue));
+                if (fReverse)
+                    pcursor->Prev();
+                else
+                    pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    UpdateAddressBalances(batch, vect, false);
     return WriteBatch(batch);
 }
 
@@ -232,9 +438,133 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKe
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+    UpdateAddressBalances(batch, vect, true);
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::ReadAddressIndexPage(uint160 addressHash, int type, int start, int end,
+                                        const CAddressIndexKey *pafter, bool fReverse, size_t nLimit,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (pafter) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pafter));
+        std::pair<char,CAddressIndexKey> key;
+        if (fReverse) {
+            StepBack(pcursor.get());
+        } else if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX &&
+                   key.second.blockHeight == pafter->blockHeight && key.second.txindex == pafter->txindex &&
+                   key.second.txhash == pafter->txhash && key.second.index == pafter->index &&
+                   key.second.spending == pafter->spending) {
+            pcursor->Next();
+        }
+    } else if (fReverse) {
+        // a height of -1 is stored as 0xffffffff and sorts after every block
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, end > 0 ? end + 1 : -1)));
+        StepBack(pcursor.get());
+    } else if (start > 0) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid() && addressIndex.size() < nLimit) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != (unsigned int)type || key.second.hashBytes != addressHash)
+            break;
+        // rows outside of the height range end the page when moving away from it, and are skipped otherwise
+        if ((end > 0 && key.second.blockHeight > end) || (start > 0 && key.second.blockHeight < start)) {
+            if ((end > 0 && key.second.blockHeight > end) != fReverse)
+                break;
+        } else {
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address index value");
+            addressIndex.push_back(make_pair(key.second, nValue));
+        }
+        if (fReverse)
+            pcursor->Prev();
+        else
+            pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance) {
+    balance.SetNull();
+    // no record just means the address was never used
+    Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance);
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalances(const std::vector<std::pair<uint160, int> > &addresses, CAddressBalanceValue &total) {
+    total.SetNull();
+    // point reads in key order hit the same blocks one after another
+    std::vector<std::pair<unsigned int, uint160> > vSorted = SortAddresses(addresses);
+    for (std::vector<std::pair<unsigned int, uint160> >::const_iterator it=vSorted.begin(); it!=vSorted.end(); it++) {
+        CAddressBalanceValue balance;
+        Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(it->first, it->second)), balance);
+        total.balance += balance.balance;
+        total.received += balance.received;
+        total.txcount += balance.txcount;
+    }
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressBalanceIndex() {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(DB_ADDRESSINDEX);
+
+    // rows are sorted by address, then by height and tx, so each address is summed up in one go
+    std::vector<std::pair<CAddressIndexIteratorKey, CAddressBalanceValue> > vBalances;
+    CAddressIndexIteratorKey address;
+    CAddressBalanceValue balance;
+    uint256 lastTxHash;
+    bool fFirst = true;
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        bool fValid = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (!fFirst && (!fValid || key.second.type != address.type || key.second.hashBytes != address.hashBytes)) {
+            vBalances.push_back(make_pair(address, balance));
+        }
+        if (!vBalances.empty() && (!fValid || vBalances.size() >= 10000)) {
+            CDBBatch batch(&GetObfuscateKey());
+            for (std::vector<std::pair<CAddressIndexIteratorKey, CAddressBalanceValue> >::const_iterator it=vBalances.begin(); it!=vBalances.end(); it++)
+                batch.Write(make_pair(DB_ADDRESSBALANCE, it->first), it->second);
+            if (!WriteBatch(batch))
+                return error("failed to write address balances");
+            vBalances.clear();
+        }
+        if (!fValid)
+            break;
+
+        if (fFirst || key.second.type != address.type || key.second.hashBytes != address.hashBytes) {
+            address = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            balance.SetNull();
+            lastTxHash.SetNull();
+            fFirst = false;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        balance.balance += nValue;
+        if (nValue > 0)
+            balance.received += nValue;
+        if (key.second.txhash != lastTxHash) {
+            balance.txcount++;
+            lastTxHash = key.second.txhash;
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
@@ -295,6 +625,63 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
+int CBlockTreeDB::ReadIndexVersion() {
+    int nVersion = 0;
+    Read(DB_INDEX_VERSION, nVersion);
+    return nVersion;
+}
+
+bool CBlockTreeDB::WriteIndexVersion(int nVersion) {
+    return Write(DB_INDEX_VERSION, nVersion);
+}
+
+//! Move all rows from the version 0 prefix to the current one, rewriting the keys in the compact layout
+template<typename LegacyKey, typename Value>
+bool CBlockTreeDB::UpgradeIndex(char chLegacy, char chPrefix) {
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(chLegacy);
+
+    // the cursor reads a snapshot, so the rows can be moved while walking it;
+    // each batch moves whole rows so an interrupted upgrade resumes where it stopped
+    CDBBatch batch(&GetObfuscateKey());
+    size_t nRows = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,LegacyKey> key;
+        if (!pcursor->GetKey(key) || key.first != chLegacy)
+            break;
+        Value value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read index value", __func__);
+        batch.Write(make_pair(chPrefix, key.second.key), value);
+        batch.Erase(make_pair(chLegacy, key.second));
+        if (++nRows % 10000 == 0) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write index batch", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    LogPrintf("%s: moved %u rows from prefix '%c' to '%c'\n", __func__, nRows, chLegacy, chPrefix);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::UpgradeIndexes() {
+    if (!UpgradeIndex<CAddressIndexKeyV0, CAmount>(DB_ADDRESSINDEX_V0, DB_ADDRESSINDEX) ||
+        !UpgradeIndex<CAddressUnspentKeyV0, CAddressUnspentValue>(DB_ADDRESSUNSPENTINDEX_V0, DB_ADDRESSUNSPENTINDEX) ||
+        !UpgradeIndex<CSpentIndexKeyV0, CSpentIndexValue>(DB_SPENTINDEX_V0, DB_SPENTINDEX))
+        return false;
+
+    // reclaim the space of the erased rows now rather than whenever compaction gets there
+    CompactRange(DB_ADDRESSINDEX_V0, (char)(DB_ADDRESSINDEX_V0 + 1));
+    CompactRange(DB_ADDRESSUNSPENTINDEX_V0, (char)(DB_ADDRESSUNSPENTINDEX_V0 + 1));
+    CompactRange(DB_SPENTINDEX_V0, (char)(DB_SPENTINDEX_V0 + 1));
+
+    return WriteIndexVersion(INDEX_VERSION);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -335,6 +722,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
+                // Checks the stored hash against nBits only, re-hashing the header is
+                // left to VerifyBlockIndexHeaders() in LoadBlockIndexDB().
                 if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
                     return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
 
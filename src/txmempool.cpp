@@ -8,8 +8,10 @@
 #include "clientversion.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "hash.h"
 #include "main.h"
 #include "policy/fees.h"
+#include "random.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util.h"
@@ -17,8 +19,24 @@
 #include "utiltime.h"
 #include "version.h"
 
+#include <algorithm>
+
 using namespace std;
 
+CMempoolAddressHasher::CMempoolAddressHasher()
+    : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+      k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{}
+
+size_t CMempoolAddressHasher::operator()(const std::pair<uint160, int>& address) const
+{
+    // one byte write, CSipHasher::Write(uint64_t) only follows whole 8 byte words
+    unsigned char buf[24] = {};
+    memcpy(buf, address.first.begin(), 20);
+    WriteLE32(buf + 20, address.second);
+    return CSipHasher(k0, k1).Write(buf, sizeof(buf)).Finalize();
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                                  int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                                  bool poolHasNoInputsOf, CAmount _inChainInputValue,
@@ -422,11 +440,19 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     return true;
 }
 
+void CTxMemPool::addAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta, addressKeyVector &inserted)
+{
+    std::pair<uint160, int> address(key.addressBytes, key.type);
+    mapAddress[address].push_back(make_pair(key, delta));
+    if (std::find(inserted.begin(), inserted.end(), address) == inserted.end())
+        inserted.push_back(address);
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    addressKeyVector inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -436,14 +462,12 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(make_pair(key, delta));
-            inserted.push_back(key);
+            addAddressDelta(key, delta, inserted);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(make_pair(key, delta));
-            inserted.push_back(key);
+            addAddressDelta(key, delta, inserted);
         }
     }
 
@@ -452,30 +476,27 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         }
     }
 
-    mapAddressInserted.insert(make_pair(txhash, inserted));
+    if (!inserted.empty())
+        mapAddressInserted.insert(make_pair(txhash, inserted));
 }
 
-bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
+bool CTxMemPool::getAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
+    // one hash lookup per address, the copying is all that's done under the lock
     LOCK(cs);
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+    for (std::vector<std::pair<uint160, int> >::const_iterator it = addresses.begin(); it != addresses.end(); it++) {
+        addressDeltaMap::const_iterator ait = mapAddress.find(*it);
+        if (ait != mapAddress.end())
+            results.insert(results.end(), ait->second.begin(), ait->second.end());
     }
     return true;
 }
@@ -486,9 +507,20 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        for (addressKeyVector::const_iterator kit = it->second.begin(); kit != it->second.end(); kit++) {
+            addressDeltaMap::iterator ait = mapAddress.find(*kit);
+            if (ait == mapAddress.end())
+                continue;
+            // drop the deltas of this tx in one pass, keeping the others in order
+            addressDeltaVector &deltas = ait->second;
+            addressDeltaVector::iterator dest = deltas.begin();
+            for (addressDeltaVector::iterator dit = deltas.begin(); dit != deltas.end(); dit++) {
+                if (dit->first.txhash != txhash)
+                    *dest++ = *dit;
+            }
+            deltas.erase(dest, deltas.end());
+            if (deltas.empty())
+                mapAddress.erase(ait);
         }
         mapAddressInserted.erase(it);
     }
@@ -17,8 +17,11 @@
 #include "sync.h"
 
 #undef foreach
+#include "prevector.h"
+
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
+#include "boost/unordered_map.hpp"
 
 class CAutoFile;
 class CBlockIndex;
@@ -422,10 +425,14 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    // deltas of each address, most addresses only have one or two in the mempool so they are kept inline
+    typedef prevector<2, std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > addressDeltaVector;
+    typedef boost::unordered_map<std::pair<uint160, int>, addressDeltaVector, CMempoolAddressHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    // addresses each tx added deltas to
+    typedef prevector<4, std::pair<uint160, int> > addressKeyVector;
+    typedef std::map<uint256, addressKeyVector> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
     typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
@@ -434,6 +441,7 @@ private:
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    void addAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta, addressKeyVector &inserted);
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -466,7 +474,7 @@ public:
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool fCurrentEstimate = true);
 
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
-    bool getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
+    bool getAddressIndex(const std::vector<std::pair<uint160, int> > &addresses,
                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
     bool removeAddressIndex(const uint256 txhash);
 